@@ -0,0 +1,78 @@
+#include "net/BambooProxy.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+using namespace bamboo;
+
+void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [-p port] -b ip:port[,ip:port...] [-c pool_size]\n"
+          "  -p port       listen port, default 9980\n"
+          "  -b backends   bamboo servers to shard keys across\n"
+          "  -c pool_size  connections to each backend, default 2\n",
+          prog);
+}
+
+// parse "ip:port,ip:port"
+bool parseBackends(const char *arg, std::vector<InetAddress> *addrs) {
+  const char *start = arg;
+  while (*start != '\0') {
+    const char *end = strchr(start, ',');
+    if (end == nullptr) {
+      end = start + strlen(start);
+    }
+    std::string addr(start, end);
+    size_t colon = addr.find(':');
+    if (colon == std::string::npos) {
+      return false;
+    }
+    addrs->emplace_back(static_cast<uint16_t>(atoi(addr.c_str() + colon + 1)),
+                        addr.substr(0, colon));
+    start = *end == ',' ? end + 1 : end;
+  }
+  return !addrs->empty();
+}
+
+int main(int argc, char *argv[]) {
+  uint16_t port = 9980;
+  int pool_size = 2;
+  std::vector<InetAddress> backends;
+
+  int opt;
+  while ((opt = ::getopt(argc, argv, "p:b:c:h")) != -1) {
+    switch (opt) {
+    case 'p':
+      port = static_cast<uint16_t>(atoi(optarg));
+      break;
+    case 'b':
+      if (!parseBackends(optarg, &backends)) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'c':
+      pool_size = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (backends.empty() || pool_size <= 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  EventLoop loop;
+  InetAddress listenAddr(port);
+  BambooProxy proxy(&loop, listenAddr, backends, pool_size);
+  proxy.start();
+  loop.loop();
+}
@@ -1,13 +1,167 @@
+#include "base/AsyncLogging.h"
+#include "base/Logging.h"
 #include "net/BambooServer.h"
 #include "net/EventLoop.h"
 #include "net/InetAddress.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <memory>
+
 using namespace bamboo;
 
+const size_t kLogRollSize = 500 * 1000 * 1000;
+
+AsyncLogging *g_async_logging = nullptr;
+
+void asyncOutput(const char *msg, size_t len) {
+  g_async_logging->append(msg, len);
+}
+
+void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [-p port] [-d dump_dir] [-l] [-r ip:port] [-s micros]\n"
+          "       [-m port] [-L log_basename] [-w micros] [-e]\n"
+          "       [-b micros] [-B micros] [-f micros] [-i seconds]\n"
+          "       [-o bytes] [-I bytes] [-T bytes]\n"
+          "  -p port      listen port, default 9981\n"
+          "  -d dump_dir  directory of SAVE/BGSAVE dumps, default dump\n"
+          "  -l           load dumps from dump_dir at startup\n"
+          "  -r ip:port   run as a read-only replica of the primary\n"
+          "  -s micros    SLOWLOG threshold, default 10000, negative disables\n"
+          "  -m port      serve Prometheus metrics on port, path /metrics\n"
+          "  -L basename  write logs to rolling files through AsyncLogging\n"
+          "  -w micros    warn about event loop iterations slower than this\n"
+          "  -e           edge triggered epoll for client connections\n"
+          "  -b micros    busy poll the event loop for micros after events\n"
+          "  -B micros    SO_BUSY_POLL of client sockets\n"
+          "  -f micros    time budget of queued functors per loop iteration\n"
+          "  -i seconds   close clients idle for seconds\n"
+          "  -o bytes     stop reading clients with more unsent replies,\n"
+          "               default 8388608, resume at a quarter, 0 disables\n"
+          "  -I bytes     largest request of a client, default 67108864\n"
+          "  -T bytes     input buffers of all clients, default 1073741824\n",
+          prog);
+}
+
 int main(int argc, char *argv[]) {
+  uint16_t port = 9981;
+  const char *dump_dir = nullptr;
+  bool load_dumps = false;
+  const char *primary = nullptr;
+  int64_t slowlog_threshold = 10000;
+  uint16_t metrics_port = 0;
+  const char *log_basename = nullptr;
+  int64_t slow_iteration_budget = 0;
+  bool edge_triggered = false;
+  int64_t busy_poll = 0;
+  int socket_busy_poll = 0;
+  int64_t functor_budget = 0;
+  int idle_timeout = 0;
+  size_t output_limit = 8 * 1024 * 1024;
+  size_t input_limit = 64 * 1024 * 1024;
+  size_t input_total = 1024 * 1024 * 1024;
+
+  int opt;
+  const char *options = "p:d:lr:s:m:L:w:eb:B:f:i:o:I:T:h";
+  while ((opt = ::getopt(argc, argv, options)) != -1) {
+    switch (opt) {
+    case 'p':
+      port = static_cast<uint16_t>(atoi(optarg));
+      break;
+    case 'd':
+      dump_dir = optarg;
+      break;
+    case 'l':
+      load_dumps = true;
+      break;
+    case 'r':
+      primary = optarg;
+      break;
+    case 's':
+      slowlog_threshold = atoll(optarg);
+      break;
+    case 'm':
+      metrics_port = static_cast<uint16_t>(atoi(optarg));
+      break;
+    case 'L':
+      log_basename = optarg;
+      break;
+    case 'w':
+      slow_iteration_budget = atoll(optarg);
+      break;
+    case 'e':
+      edge_triggered = true;
+      break;
+    case 'b':
+      busy_poll = atoll(optarg);
+      break;
+    case 'B':
+      socket_busy_poll = atoi(optarg);
+      break;
+    case 'f':
+      functor_budget = atoll(optarg);
+      break;
+    case 'i':
+      idle_timeout = atoi(optarg);
+      break;
+    case 'o':
+      output_limit = static_cast<size_t>(atoll(optarg));
+      break;
+    case 'I':
+      input_limit = static_cast<size_t>(atoll(optarg));
+      break;
+    case 'T':
+      input_total = static_cast<size_t>(atoll(optarg));
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  std::unique_ptr<AsyncLogging> async_logging;
+  if (log_basename != nullptr) {
+    async_logging.reset(new AsyncLogging(log_basename, kLogRollSize));
+    async_logging->start();
+    g_async_logging = async_logging.get();
+    Logger::setOutput(asyncOutput);
+  }
+
   EventLoop loop;
-  InetAddress listenAddr(9981);
+  InetAddress listenAddr(port);
   BambooServer server(&loop, listenAddr);
+  server.setSlowlogThreshold(slowlog_threshold);
+  server.setAsyncLogging(async_logging.get());
+  server.setSlowIterationBudget(slow_iteration_budget);
+  server.setEdgeTriggered(edge_triggered);
+  server.setBusyPoll(busy_poll, socket_busy_poll);
+  server.setFunctorBudget(0, functor_budget);
+  server.setIdleTimeout(idle_timeout);
+  server.setBackpressure(output_limit, output_limit / 4);
+  server.setInputLimits(input_limit, input_total);
+  if (metrics_port != 0) {
+    server.setMetricsAddress(InetAddress(metrics_port));
+  }
+  if (dump_dir != nullptr) {
+    server.setDumpDirectory(dump_dir);
+  }
+  if (load_dumps) {
+    server.loadDumps();
+  }
+  if (primary != nullptr) {
+    const char *colon = strchr(primary, ':');
+    if (colon == nullptr) {
+      usage(argv[0]);
+      return 1;
+    }
+    InetAddress primaryAddr(static_cast<uint16_t>(atoi(colon + 1)),
+                            std::string(primary, colon));
+    server.setReplicaOf(primaryAddr);
+  }
   server.start();
   loop.loop();
-}
\ No newline at end of file
+}
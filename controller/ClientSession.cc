@@ -2,11 +2,13 @@
 
 #include <stdexcept>
 
+#include <stdlib.h>
+
 namespace bamboo {
 
 void ClientSession::setCurrentDbIndex(int index) {
   try {
-    db_manager_->selectDatabase(index);
+    db_manager_->checkDatabaseIndex(index);
     current_db_index_ = index;
   } catch (const std::invalid_argument &e) {
     error_message_ = e.what();
@@ -15,6 +17,10 @@ void ClientSession::setCurrentDbIndex(int index) {
 
 std::string ClientSession::processCommand(const std::string &cmd,
                                           const std::string &args) {
+  error_message_.clear();
+  if (read_only_ && (cmd == "SET" || cmd == "DEL" || cmd == "MSET")) {
+    return "ERROR: read only replica\r\n";
+  }
   if (cmd == "SELECT") {
     int dbIndex = std::stoi(args);
     setCurrentDbIndex(dbIndex);
@@ -23,21 +29,53 @@ std::string ClientSession::processCommand(const std::string &cmd,
     }
     return "OK\r\n";
   } else if (cmd == "GET") {
-    return db_manager_->get(args) + "\r\n";
+    touch(args);
+    return db_manager_->get(current_db_index_, args) + "\r\n";
   } else if (cmd == "SET") {
     size_t endPos = args.find(' ', 0);
     if (endPos != std::string::npos) {
       std::string key = args.substr(0, endPos);
       std::string value = args.substr(endPos + 1);
-      return db_manager_->set(key, value) + "\r\n";
+      touch(key);
+      return db_manager_->set(current_db_index_, key, value) + "\r\n";
     }
   } else if (cmd == "DEL") {
-    return db_manager_->del(args) + "\r\n";
+    touch(args);
+    return db_manager_->del(current_db_index_, args) + "\r\n";
+  } else if (cmd == "MGET") {
+    // one line per key, in order
+    auto keys = splitArgs(args);
+    if (keys.empty()) {
+      return "ERROR: wrong number of arguments\r\n";
+    }
+    std::string response;
+    for (const auto &key : keys) {
+      touch(key);
+      response += db_manager_->get(current_db_index_, key) + "\r\n";
+    }
+    return response;
+  } else if (cmd == "MSET") {
+    auto parts = splitArgs(args);
+    if (parts.empty() || parts.size() % 2 != 0) {
+      return "ERROR: wrong number of arguments\r\n";
+    }
+    std::vector<std::pair<std::string, std::string>> kvs;
+    for (size_t i = 0; i < parts.size(); i += 2) {
+      touch(parts[i]);
+      kvs.emplace_back(parts[i], parts[i + 1]);
+    }
+    return db_manager_->mset(current_db_index_, kvs) + "\r\n";
   } else if (cmd == "LIST") {
-    return db_manager_->listAllKVs() + "\r\n";
+    return db_manager_->listAllKVs(current_db_index_) + "\r\n";
+  } else if (cmd == "SAVE") {
+    return db_manager_->save() + "\r\n";
+  } else if (cmd == "BGSAVE") {
+    return db_manager_->bgsave() + "\r\n";
   } else if (cmd == "CURRENTDB") {
     return "Current Database Index: " + std::to_string(getCurrentDbIndex()) +
            "\r\n";
+  } else if (cmd == "HOTKEYS") {
+    return hotKeys(args);
   } else if (cmd == "HELP") {
     return showHelp();
   } else {
@@ -54,8 +92,54 @@ std::string ClientSession::showHelp() {
          "SET <key> <value> - Set the value for the key in the current "
          "database\r\n"
          "DEL <key>      - Delete the key from the current database\r\n"
+         "MGET <key> [key ...]          - Get values of keys, one per line\r\n"
+         "MSET <key> <value> [key value ...] - Set several keys at once\r\n"
          "LIST           - List all key-value pairs in the current database\r\n"
+         "SAVE           - Dump all databases to the dump directory\r\n"
+         "BGSAVE         - Dump all databases in the background\r\n"
          "CURRENTDB      - Show the current selected database index\r\n"
+         "INFO [section] - Show server and storage metrics\r\n"
+         "SLOWLOG GET [count] | LEN | RESET - Show or clear slow commands\r\n"
+         "HOTKEYS [count] - Show the most accessed keys of the current "
+         "database\r\n"
          "HELP           - Show this help message\r\n";
 }
+
+std::string ClientSession::hotKeys(const std::string &args) {
+  if (hot_keys_ == nullptr) {
+    return "ERROR: hot key sampling is disabled\r\n";
+  }
+  size_t count = HotKeys::kTopK;
+  if (!args.empty()) {
+    char *end;
+    long n = ::strtol(args.c_str(), &end, 10);
+    if (*end != '\0' || n < 0) {
+      return "ERROR: invalid count\r\n";
+    }
+    count = static_cast<size_t>(n);
+  }
+  // estimated requests, ends with a blank line like LIST
+  std::string response;
+  for (const auto &e : hot_keys_->top(current_db_index_, count)) {
+    response += e.first + ": " + std::to_string(e.second) + "\r\n";
+  }
+  return response + "\r\n";
+}
+
+std::vector<std::string> ClientSession::splitArgs(const std::string &args) {
+  std::vector<std::string> parts;
+  size_t start = 0;
+  while (start < args.size()) {
+    size_t end = args.find(' ', start);
+    if (end == std::string::npos) {
+      end = args.size();
+    }
+    if (end > start) {
+      parts.emplace_back(args, start, end - start);
+    }
+    start = end + 1;
+  }
+  return parts;
+}
+
 } // namespace bamboo
\ No newline at end of file
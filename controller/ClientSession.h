@@ -1,6 +1,10 @@
 #pragma once
 
 #include "controller/DatabaseManager.h"
+#include "controller/HotKeys.h"
+
+#include <string>
+#include <vector>
 
 namespace bamboo {
 class ClientSession {
@@ -13,13 +17,32 @@ public:
 
   std::string getErrorMessage() const { return error_message_; }
 
+  // reject SET/DEL, for sessions of a replica
+  void setReadOnly(bool on) { read_only_ = on; }
+
+  // sample accessed keys, enables HOTKEYS
+  void setHotKeys(HotKeys *hotKeys) { hot_keys_ = hotKeys; }
+
   std::string processCommand(const std::string &cmd, const std::string &args);
 
+  static std::string showHelp();
+
+  // split args by single spaces
+  static std::vector<std::string> splitArgs(const std::string &args);
+
 private:
+  std::string hotKeys(const std::string &args);
+
+  void touch(const std::string &key) {
+    if (hot_keys_ != nullptr) {
+      hot_keys_->touch(current_db_index_, key);
+    }
+  }
+
   DatabaseManager *db_manager_;
   int current_db_index_;
+  bool read_only_{false};
+  HotKeys *hot_keys_{nullptr};
   std::string error_message_;
-
-  std::string showHelp();
 };
 } // namespace bamboo
\ No newline at end of file
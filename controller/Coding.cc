@@ -0,0 +1,109 @@
+#include "controller/Coding.h"
+
+namespace {
+
+struct Crc32Table {
+  Crc32Table() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k) {
+        c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+      }
+      table[i] = c;
+    }
+  }
+
+  uint32_t table[256];
+};
+
+const Crc32Table kCrc32Table;
+
+} // namespace
+
+namespace bamboo {
+namespace coding {
+
+void putFixed32(std::string *dst, uint32_t value) {
+  char buf[sizeof(value)];
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    buf[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+  }
+  dst->append(buf, sizeof(buf));
+}
+
+void putFixed64(std::string *dst, uint64_t value) {
+  char buf[sizeof(value)];
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    buf[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+  }
+  dst->append(buf, sizeof(buf));
+}
+
+uint32_t decodeFixed32(const char *ptr) {
+  const auto *p = reinterpret_cast<const uint8_t *>(ptr);
+  uint32_t value = 0;
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    value |= static_cast<uint32_t>(p[i]) << (8 * i);
+  }
+  return value;
+}
+
+uint64_t decodeFixed64(const char *ptr) {
+  const auto *p = reinterpret_cast<const uint8_t *>(ptr);
+  uint64_t value = 0;
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    value |= static_cast<uint64_t>(p[i]) << (8 * i);
+  }
+  return value;
+}
+
+void putVarint32(std::string *dst, uint32_t value) {
+  char buf[5];
+  size_t len = 0;
+  while (value >= 0x80) {
+    buf[len++] = static_cast<char>(value | 0x80);
+    value >>= 7;
+  }
+  buf[len++] = static_cast<char>(value);
+  dst->append(buf, len);
+}
+
+void putLengthPrefixed(std::string *dst, const char *data, size_t len) {
+  putVarint32(dst, static_cast<uint32_t>(len));
+  dst->append(data, len);
+}
+
+const char *getVarint32(const char *ptr, const char *limit, uint32_t *value) {
+  uint32_t result = 0;
+  for (uint32_t shift = 0; shift <= 28 && ptr < limit; shift += 7) {
+    uint32_t byte = static_cast<uint8_t>(*ptr++);
+    result |= (byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return ptr;
+    }
+  }
+  return nullptr;
+}
+
+const char *getLengthPrefixed(const char *ptr, const char *limit,
+                              const char **data, uint32_t *len) {
+  ptr = getVarint32(ptr, limit, len);
+  if (ptr == nullptr || static_cast<size_t>(limit - ptr) < *len) {
+    return nullptr;
+  }
+  *data = ptr;
+  return ptr + *len;
+}
+
+uint32_t crc32(uint32_t crc, const char *data, size_t len) {
+  const auto *p = reinterpret_cast<const uint8_t *>(data);
+  crc = ~crc;
+  for (size_t i = 0; i < len; ++i) {
+    crc = kCrc32Table.table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+} // namespace coding
+} // namespace bamboo
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+namespace bamboo {
+namespace coding {
+
+// little-endian fixed width integers
+void putFixed32(std::string *dst, uint32_t value);
+void putFixed64(std::string *dst, uint64_t value);
+
+uint32_t decodeFixed32(const char *ptr);
+uint64_t decodeFixed64(const char *ptr);
+
+// 7 bits per byte, at most 5 bytes
+void putVarint32(std::string *dst, uint32_t value);
+
+// varint32 length followed by the bytes
+void putLengthPrefixed(std::string *dst, const char *data, size_t len);
+
+// return pointer past the parsed value
+// return nullptr if input is truncated or malformed
+const char *getVarint32(const char *ptr, const char *limit, uint32_t *value);
+
+const char *getLengthPrefixed(const char *ptr, const char *limit,
+                              const char **data, uint32_t *len);
+
+// CRC-32 (IEEE 802.3), extend crc with data[0, len)
+uint32_t crc32(uint32_t crc, const char *data, size_t len);
+
+} // namespace coding
+} // namespace bamboo
@@ -1,78 +1,105 @@
 #include "controller/DatabaseManager.h"
 
+#include "base/Logging.h"
+#include "controller/DumpFile.h"
+
 #include <leveldb/db.h>
+#include <leveldb/write_batch.h>
 #include <sstream>
+#include <stdexcept>
 
+#include <assert.h>
 #include <dirent.h>
+#include <stdio.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 namespace bamboo {
 
-DatabaseManager::DatabaseManager() {
-  // Ensure the dbinstance directory exists
-  if (!directoryExists("dbinstance")) {
-    createDirectory("dbinstance");
+namespace {
+// flush a write batch to leveldb every 4MB when loading a dump
+constexpr size_t kLoadBatchBytes = 4 * 1024 * 1024;
+} // namespace
+
+DatabaseManager::DatabaseManager(const std::string &dataDir) {
+  // Ensure the data directory exists
+  if (!directoryExists(dataDir)) {
+    createDirectory(dataDir);
   }
 
-  for (int i = 0; i < 10; ++i) {
+  for (int i = 0; i < kNumDatabases; ++i) {
     leveldb::Options options;
     options.create_if_missing = true;
     std::ostringstream oss;
-    oss << "dbinstance/testdb" << i;
+    oss << dataDir << "/testdb" << i;
     leveldb::Status status = leveldb::DB::Open(options, oss.str(), &dbs_[i]);
     assert(status.ok());
   }
 }
 
 DatabaseManager::~DatabaseManager() {
+  if (bgsave_thread_) {
+    bgsave_thread_->join();
+  }
   for (auto &db : dbs_) {
     delete db;
   }
 }
 
-void DatabaseManager::selectDatabase(int dbIndex) {
-  if (dbIndex >= 0 && dbIndex < 10) {
-    current_db_index_ = dbIndex;
-  } else {
+void DatabaseManager::checkDatabaseIndex(int dbIndex) const {
+  if (dbIndex < 0 || dbIndex >= kNumDatabases) {
     throw std::invalid_argument("Invalid database index");
   }
 }
 
-std::string DatabaseManager::get(const std::string &key) {
+std::string DatabaseManager::get(int dbIndex, const std::string &key) {
   std::string value;
-  leveldb::Status s =
-      dbs_[current_db_index_]->Get(leveldb::ReadOptions(), key, &value);
+  leveldb::Status s = dbs_[dbIndex]->Get(leveldb::ReadOptions(), key, &value);
   if (s.ok()) {
+    keyspace_hits_.fetch_add(1, std::memory_order_relaxed);
     return value;
   } else {
+    keyspace_misses_.fetch_add(1, std::memory_order_relaxed);
     return "NOT FOUND";
   }
 }
 
-std::string DatabaseManager::set(const std::string &key,
+std::string DatabaseManager::set(int dbIndex, const std::string &key,
                                  const std::string &value) {
-  leveldb::Status s =
-      dbs_[current_db_index_]->Put(leveldb::WriteOptions(), key, value);
-  if (s.ok()) {
+  leveldb::WriteBatch batch;
+  batch.Put(key, value);
+  if (write(dbIndex, &batch)) {
     return "OK";
   } else {
     return "ERROR";
   }
 }
 
-std::string DatabaseManager::del(const std::string &key) {
-  leveldb::Status s = dbs_[current_db_index_]->Delete(leveldb::WriteOptions(),
-                                                      key);
-  if (s.ok()) {
+std::string DatabaseManager::del(int dbIndex, const std::string &key) {
+  leveldb::WriteBatch batch;
+  batch.Delete(key);
+  if (write(dbIndex, &batch)) {
+    return "OK";
+  } else {
+    return "ERROR";
+  }
+}
+
+std::string DatabaseManager::mset(
+    int dbIndex, const std::vector<std::pair<std::string, std::string>> &kvs) {
+  leveldb::WriteBatch batch;
+  for (const auto &kv : kvs) {
+    batch.Put(kv.first, kv.second);
+  }
+  if (write(dbIndex, &batch)) {
     return "OK";
   } else {
     return "ERROR";
   }
 }
 
-std::string DatabaseManager::listAllKVs() {
-  leveldb::Iterator *it =
-      dbs_[current_db_index_]->NewIterator(leveldb::ReadOptions());
+std::string DatabaseManager::listAllKVs(int dbIndex) {
+  leveldb::Iterator *it = dbs_[dbIndex]->NewIterator(leveldb::ReadOptions());
   std::string response;
   for (it->SeekToFirst(); it->Valid(); it->Next()) {
     response += it->key().ToString() + ": " + it->value().ToString() + "\r\n";
@@ -85,6 +112,125 @@ std::string DatabaseManager::listAllKVs() {
   }
 }
 
+std::string DatabaseManager::property(int dbIndex, const std::string &name) {
+  std::string value;
+  if (!dbs_[dbIndex]->GetProperty(name, &value)) {
+    value.clear();
+  }
+  return value;
+}
+
+bool DatabaseManager::applyBatch(int dbIndex, leveldb::WriteBatch *batch) {
+  if (dbIndex < 0 || dbIndex >= kNumDatabases) {
+    return false;
+  }
+  return write(dbIndex, batch);
+}
+
+std::string DatabaseManager::dumpPath(int dbIndex) const {
+  return dump_dir_ + "/db" + std::to_string(dbIndex) + ".dump";
+}
+
+std::string DatabaseManager::save() {
+  if (bgsave_in_progress_) {
+    return "ERROR: background save already in progress";
+  }
+  if (saveSnapshots(takeSnapshots()) != 0) {
+    return "ERROR";
+  }
+  return "OK";
+}
+
+std::string DatabaseManager::bgsave() {
+  if (bgsave_in_progress_.exchange(true)) {
+    return "ERROR: background save already in progress";
+  }
+  // previous background save has finished, reap its thread
+  if (bgsave_thread_) {
+    bgsave_thread_->join();
+  }
+
+  // snapshots are taken in the caller thread, so the dump is a point in time
+  // view of all databases; writing them out does not block writers
+  auto snapshots = takeSnapshots();
+  bgsave_thread_.reset(new Thread(
+      [this, snapshots]() {
+        saveSnapshots(snapshots);
+        bgsave_in_progress_ = false;
+      },
+      "BgSave"));
+  bgsave_thread_->start();
+  return "Background saving started";
+}
+
+void DatabaseManager::loadDumps() {
+  for (int i = 0; i < kNumDatabases; ++i) {
+    auto path = dumpPath(i);
+    if (::access(path.c_str(), R_OK) == 0) {
+      loadDump(i, path);
+    }
+  }
+}
+
+bool DatabaseManager::loadDump(int dbIndex, const std::string &path) {
+  DumpReader reader(path);
+  if (!reader.valid()) {
+    LOG_ERROR << "load dump " << path << " failed: " << reader.error();
+    return false;
+  }
+  // a dump copied or renamed from another database
+  if (reader.dbIndex() != dbIndex) {
+    LOG_ERROR << "load dump " << path << " failed: dump of db "
+              << reader.dbIndex() << ", not db " << dbIndex;
+    return false;
+  }
+  return loadDump(dbIndex, &reader);
+}
+
+bool DatabaseManager::loadDump(int dbIndex, DumpReader *reader) {
+  auto db = dbs_[dbIndex];
+  leveldb::WriteBatch batch;
+  // drop keys that are not in the dump
+  std::unique_ptr<leveldb::Iterator> it(db->NewIterator(leveldb::ReadOptions()));
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    batch.Delete(it->key());
+  }
+  it.reset();
+
+  const char *key;
+  const char *value;
+  size_t key_len;
+  size_t value_len;
+  uint64_t loaded = 0;
+  while (reader->next(&key, &key_len, &value, &value_len)) {
+    batch.Put(leveldb::Slice(key, key_len), leveldb::Slice(value, value_len));
+    ++loaded;
+    if (batch.ApproximateSize() >= kLoadBatchBytes) {
+      leveldb::Status s = db->Write(leveldb::WriteOptions(), &batch);
+      if (!s.ok()) {
+        LOG_ERROR << "load dump into db " << dbIndex << " failed after "
+                  << loaded << " records: " << s.ToString();
+        return false;
+      }
+      batch.Clear();
+    }
+  }
+  leveldb::Status s = db->Write(leveldb::WriteOptions(), &batch);
+  if (!s.ok()) {
+    LOG_ERROR << "load dump into db " << dbIndex << " failed: "
+              << s.ToString();
+    return false;
+  }
+
+  if (!reader->valid() || loaded != reader->count()) {
+    LOG_ERROR << "load dump into db " << dbIndex << " stopped after " << loaded
+              << " records: " << reader->error();
+    return false;
+  }
+  LOG_INFO << "loaded " << loaded << " keys into db " << dbIndex;
+  return true;
+}
+
 bool DatabaseManager::directoryExists(const std::string &path) {
   struct stat st;
   if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
@@ -97,4 +243,84 @@ void DatabaseManager::createDirectory(const std::string &path) {
   mkdir(path.c_str(), 0755);
 }
 
-} // namespace bamboo
\ No newline at end of file
+DatabaseManager::SnapshotList DatabaseManager::takeSnapshots() {
+  SnapshotList snapshots;
+  for (auto db : dbs_) {
+    snapshots.push_back(db->GetSnapshot());
+  }
+  return snapshots;
+}
+
+void DatabaseManager::releaseSnapshots(const SnapshotList &snapshots) {
+  for (int i = 0; i < kNumDatabases; ++i) {
+    dbs_[i]->ReleaseSnapshot(snapshots[i]);
+  }
+}
+
+bool DatabaseManager::dump(int dbIndex, const leveldb::Snapshot *snapshot,
+                           DumpWriter *writer) {
+  leveldb::ReadOptions options;
+  options.snapshot = snapshot;
+  // a full scan should not evict the hot blocks
+  options.fill_cache = false;
+  std::unique_ptr<leveldb::Iterator> it(dbs_[dbIndex]->NewIterator(options));
+
+  bool ok = true;
+  for (it->SeekToFirst(); ok && it->Valid(); it->Next()) {
+    ok = writer->add(it->key().data(), it->key().size(), it->value().data(),
+                     it->value().size());
+  }
+  return ok && it->status().ok();
+}
+
+int DatabaseManager::saveSnapshots(const SnapshotList &snapshots) {
+  if (!directoryExists(dump_dir_)) {
+    createDirectory(dump_dir_);
+  }
+
+  int failed = 0;
+  for (int i = 0; i < kNumDatabases; ++i) {
+    if (!writeDump(i, snapshots[i])) {
+      ++failed;
+    }
+  }
+  releaseSnapshots(snapshots);
+  return failed;
+}
+
+bool DatabaseManager::writeDump(int dbIndex, const leveldb::Snapshot *snapshot) {
+  // write to a temporary file, rename it when complete
+  auto path = dumpPath(dbIndex);
+  auto tmp_path = path + ".tmp";
+  FILE *fp = ::fopen(tmp_path.c_str(), "we");
+  if (fp == nullptr) {
+    LOG_SYSERR << "open " << tmp_path;
+    return false;
+  }
+
+  DumpWriter writer(dbIndex, [fp](const char *data, size_t len) {
+    return ::fwrite_unlocked(data, 1, len, fp) == len;
+  });
+  bool ok = dump(dbIndex, snapshot, &writer) && writer.finish();
+  ok = ::fflush(fp) == 0 && ::fsync(::fileno(fp)) == 0 && ok;
+  ::fclose(fp);
+
+  if (!ok || ::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    LOG_ERROR << "dump db " << dbIndex << " to " << path << " failed";
+    ::unlink(tmp_path.c_str());
+    return false;
+  }
+  LOG_INFO << "dumped " << writer.count() << " keys of db " << dbIndex
+           << " to " << path << ", " << writer.bytesWritten() << " bytes";
+  return true;
+}
+
+bool DatabaseManager::write(int dbIndex, leveldb::WriteBatch *batch) {
+  leveldb::Status s = dbs_[dbIndex]->Write(leveldb::WriteOptions(), batch);
+  if (s.ok() && write_callback_) {
+    write_callback_(dbIndex, *batch);
+  }
+  return s.ok();
+}
+
+} // namespace bamboo
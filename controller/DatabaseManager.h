@@ -1,38 +1,127 @@
 #pragma once
 
+#include "base/Thread.h"
+
 #include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace leveldb {
 class DB;
+class Snapshot;
+class WriteBatch;
 }
 
 namespace bamboo {
+
+class DumpReader;
+class DumpWriter;
+
 class DatabaseManager {
 public:
-  DatabaseManager();
+  using SnapshotList = std::vector<const leveldb::Snapshot *>;
+  // called in the writer's thread after a write is applied
+  using WriteCallback =
+      std::function<void(int dbIndex, const leveldb::WriteBatch &batch)>;
+
+  static constexpr int kNumDatabases = 10;
+
+  // databases live in dataDir/testdb0 .. testdb9
+  explicit DatabaseManager(const std::string &dataDir = "dbinstance");
 
   ~DatabaseManager();
 
-  void selectDatabase(int dbIndex);
+  // throw std::invalid_argument if dbIndex is out of range
+  void checkDatabaseIndex(int dbIndex) const;
+
+  std::string get(int dbIndex, const std::string &key);
+
+  std::string set(int dbIndex, const std::string &key,
+                  const std::string &value);
+
+  std::string del(int dbIndex, const std::string &key);
+
+  // set all pairs in one atomic write
+  std::string mset(int dbIndex,
+                   const std::vector<std::pair<std::string, std::string>> &kvs);
+
+  std::string listAllKVs(int dbIndex);
+
+  // value of a leveldb property such as "leveldb.stats", empty if unknown
+  std::string property(int dbIndex, const std::string &name);
+
+  // GET of existing and missing keys
+  uint64_t keyspaceHits() const {
+    return keyspace_hits_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t keyspaceMisses() const {
+    return keyspace_misses_.load(std::memory_order_relaxed);
+  }
 
-  int getCurrentDatabaseIndex() const { return current_db_index_; }
+  // apply a batch replicated from the primary
+  bool applyBatch(int dbIndex, leveldb::WriteBatch *batch);
 
-  std::string get(const std::string &key);
+  void setWriteCallback(const WriteCallback &cb) { write_callback_ = cb; }
 
-  std::string set(const std::string &key, const std::string &value);
+  // directory of dump files, default "dump"
+  void setDumpDirectory(const std::string &dir) { dump_dir_ = dir; }
 
-  std::string del(const std::string &key);
+  const std::string &dumpDirectory() const { return dump_dir_; }
 
-  std::string listAllKVs();
+  // e.g. dump/db3.dump
+  std::string dumpPath(int dbIndex) const;
+
+  // dump every database, block until finished
+  std::string save();
+
+  // snapshot every database now, write dumps in a background thread
+  std::string bgsave();
+
+  bool bgsaveInProgress() const { return bgsave_in_progress_; }
+
+  // replace contents of every database that has a dump file
+  void loadDumps();
+
+  // replace contents of database with the dump
+  // return false if dump is missing, corrupted, of another database or
+  // could not be written
+  bool loadDump(int dbIndex, const std::string &path);
+
+  bool loadDump(int dbIndex, DumpReader *reader);
+
+  // one snapshot per database, release with releaseSnapshots()
+  SnapshotList takeSnapshots();
+
+  void releaseSnapshots(const SnapshotList &snapshots);
+
+  // write all records of the snapshot, without finishing the writer
+  bool dump(int dbIndex, const leveldb::Snapshot *snapshot, DumpWriter *writer);
 
 private:
   bool directoryExists(const std::string &path);
 
   void createDirectory(const std::string &path);
 
-  std::array<leveldb::DB *, 10> dbs_;
-  int current_db_index_ = 0;
+  bool write(int dbIndex, leveldb::WriteBatch *batch);
+
+  // write and release snapshots, return number of dumps failed
+  int saveSnapshots(const SnapshotList &snapshots);
+
+  bool writeDump(int dbIndex, const leveldb::Snapshot *snapshot);
+
+  std::array<leveldb::DB *, kNumDatabases> dbs_;
+  WriteCallback write_callback_;
+  std::atomic<uint64_t> keyspace_hits_{0};
+  std::atomic<uint64_t> keyspace_misses_{0};
+
+  std::string dump_dir_{"dump"};
+  std::atomic<bool> bgsave_in_progress_{false};
+  std::unique_ptr<Thread> bgsave_thread_;
 };
 
-} // namespace bamboo
\ No newline at end of file
+} // namespace bamboo
@@ -0,0 +1,160 @@
+#include "controller/DumpFile.h"
+
+#include "controller/Coding.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kMagic[] = "BAMBOODB";
+constexpr size_t kMagicSize = sizeof(kMagic) - 1;
+constexpr uint32_t kVersion = 1;
+
+constexpr size_t kHeaderSize = kMagicSize + 4 + 4;
+// EOF type + count + crc32
+constexpr size_t kFooterSize = 1 + 8 + 4;
+
+constexpr char kTypeValue = 1;
+constexpr char kTypeEof = static_cast<char>(0xff);
+
+// flush buffered records to the sink every 64KB
+constexpr size_t kFlushSize = 64 * 1024;
+
+} // namespace
+
+namespace bamboo {
+
+DumpWriter::DumpWriter(int dbIndex, Sink sink) : sink_(std::move(sink)) {
+  buffer_.reserve(kFlushSize * 2);
+  buffer_.append(kMagic, kMagicSize);
+  coding::putFixed32(&buffer_, kVersion);
+  coding::putFixed32(&buffer_, static_cast<uint32_t>(dbIndex));
+}
+
+bool DumpWriter::add(const char *key, size_t key_len, const char *value,
+                     size_t value_len) {
+  buffer_.push_back(kTypeValue);
+  coding::putLengthPrefixed(&buffer_, key, key_len);
+  coding::putLengthPrefixed(&buffer_, value, value_len);
+  ++count_;
+  if (buffer_.size() >= kFlushSize) {
+    return flush();
+  }
+  return ok_;
+}
+
+bool DumpWriter::finish() {
+  buffer_.push_back(kTypeEof);
+  coding::putFixed64(&buffer_, count_);
+  crc_ = coding::crc32(crc_, buffer_.data(), buffer_.size());
+  coding::putFixed32(&buffer_, crc_);
+  ok_ = ok_ && sink_(buffer_.data(), buffer_.size());
+  bytes_written_ += buffer_.size();
+  buffer_.clear();
+  return ok_;
+}
+
+bool DumpWriter::flush() {
+  crc_ = coding::crc32(crc_, buffer_.data(), buffer_.size());
+  ok_ = ok_ && sink_(buffer_.data(), buffer_.size());
+  bytes_written_ += buffer_.size();
+  buffer_.clear();
+  return ok_;
+}
+
+DumpReader::DumpReader(const std::string &path) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    error_ = "open " + path + " failed";
+    return;
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) < 0 || st.st_size == 0) {
+    error_ = "empty dump " + path;
+    ::close(fd);
+    return;
+  }
+
+  void *addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    error_ = "mmap " + path + " failed";
+    return;
+  }
+  // records are read once from front to back
+  ::madvise(addr, st.st_size, MADV_SEQUENTIAL);
+
+  mapped_ = addr;
+  data_ = static_cast<const char *>(addr);
+  len_ = static_cast<size_t>(st.st_size);
+  parse();
+}
+
+DumpReader::DumpReader(const char *data, size_t len) : data_(data), len_(len) {
+  parse();
+}
+
+DumpReader::~DumpReader() {
+  if (mapped_ != nullptr) {
+    ::munmap(mapped_, len_);
+  }
+}
+
+void DumpReader::parse() {
+  if (len_ < kHeaderSize + kFooterSize) {
+    error_ = "dump is truncated";
+    return;
+  }
+  if (memcmp(data_, kMagic, kMagicSize) != 0) {
+    error_ = "bad dump magic";
+    return;
+  }
+  if (coding::decodeFixed32(data_ + kMagicSize) != kVersion) {
+    error_ = "unsupported dump version";
+    return;
+  }
+
+  const char *footer = data_ + len_ - kFooterSize;
+  uint32_t expected = coding::decodeFixed32(footer + 1 + 8);
+  if (coding::crc32(0, data_, len_ - 4) != expected) {
+    error_ = "dump checksum mismatch";
+    return;
+  }
+  if (footer[0] != kTypeEof) {
+    error_ = "dump has no EOF marker";
+    return;
+  }
+
+  db_index_ = static_cast<int>(coding::decodeFixed32(data_ + kMagicSize + 4));
+  count_ = coding::decodeFixed64(footer + 1);
+  cur_ = data_ + kHeaderSize;
+  limit_ = footer;
+}
+
+bool DumpReader::next(const char **key, size_t *key_len, const char **value,
+                      size_t *value_len) {
+  if (!valid() || cur_ >= limit_) {
+    return false;
+  }
+
+  uint32_t klen = 0;
+  uint32_t vlen = 0;
+  const char *p = cur_;
+  if (*p++ != kTypeValue ||
+      (p = coding::getLengthPrefixed(p, limit_, key, &klen)) == nullptr ||
+      (p = coding::getLengthPrefixed(p, limit_, value, &vlen)) == nullptr) {
+    error_ = "corrupted dump record";
+    return false;
+  }
+  *key_len = klen;
+  *value_len = vlen;
+  cur_ = p;
+  return true;
+}
+
+} // namespace bamboo
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "base/Macro.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+
+namespace bamboo {
+
+/// Binary dump of one database, written from a leveldb snapshot.
+///
+/// @code
+/// +---------+---------+----------+-----------------------+-----+---------+---------+
+/// |  magic  | version | db index |  records              | EOF |  count  |  crc32  |
+/// | 8 bytes | fixed32 | fixed32  | type key value ...    |  1  | fixed64 | fixed32 |
+/// +---------+---------+----------+-----------------------+-----+---------+---------+
+/// @endcode
+///
+/// key and value are varint32 length prefixed, crc32 covers every byte
+/// before it.
+class DumpWriter {
+public:
+  // return false if the bytes could not be written
+  using Sink = std::function<bool(const char *data, size_t len)>;
+
+  DumpWriter(int dbIndex, Sink sink);
+
+  DISALLOW_COPY(DumpWriter)
+
+  bool add(const char *key, size_t key_len, const char *value,
+           size_t value_len);
+
+  // write footer and flush, no more add() after it
+  bool finish();
+
+  uint64_t count() const { return count_; }
+
+  uint64_t bytesWritten() const { return bytes_written_; }
+
+private:
+  bool flush();
+
+  Sink sink_;
+  std::string buffer_;
+  uint32_t crc_{0};
+  uint64_t count_{0};
+  uint64_t bytes_written_{0};
+  bool ok_{true};
+};
+
+// read a dump from memory, or from a file mapped with mmap
+class DumpReader {
+public:
+  // map the file, check header and checksum
+  explicit DumpReader(const std::string &path);
+
+  // dump bytes must outlive the reader
+  DumpReader(const char *data, size_t len);
+
+  DISALLOW_COPY(DumpReader)
+
+  ~DumpReader();
+
+  bool valid() const { return error_.empty(); }
+
+  const std::string &error() const { return error_; }
+
+  int dbIndex() const { return db_index_; }
+
+  // number of records recorded in the footer
+  uint64_t count() const { return count_; }
+
+  // return false at the end of the dump or on a corrupted record
+  bool next(const char **key, size_t *key_len, const char **value,
+            size_t *value_len);
+
+private:
+  void parse();
+
+  const char *data_{nullptr};
+  size_t len_{0};
+  void *mapped_{nullptr};
+  const char *cur_{nullptr};
+  const char *limit_{nullptr};
+  int db_index_{-1};
+  uint64_t count_{0};
+  std::string error_;
+};
+
+} // namespace bamboo
@@ -0,0 +1,114 @@
+#include "controller/HotKeys.h"
+
+#include "base/Hash.h"
+
+#include <algorithm>
+
+namespace bamboo {
+
+constexpr int HotKeys::kDepth;
+constexpr size_t HotKeys::kWidth;
+constexpr size_t HotKeys::kTopK;
+constexpr uint32_t HotKeys::kDecayPeriod;
+
+struct HotKeys::Database {
+  using KeyCount = std::pair<std::string, uint32_t>;
+
+  uint32_t counters[kDepth][kWidth] = {};
+  uint32_t samples{0};
+  // unordered, at most kTopK
+  std::vector<KeyCount> top;
+};
+
+HotKeys::HotKeys(int numDatabases, uint32_t sampleInterval)
+    : sample_interval_(std::max<uint32_t>(1, sampleInterval)) {
+  for (int i = 0; i < numDatabases; ++i) {
+    dbs_.emplace_back(new Database);
+    dbs_.back()->top.reserve(kTopK);
+  }
+}
+
+HotKeys::~HotKeys() = default;
+
+void HotKeys::sample(int dbIndex, const std::string &key) {
+  uint64_t h = hash64(key.data(), key.size());
+  // the rows use h1 + i * h2 as independent hashes
+  auto h1 = static_cast<uint32_t>(h);
+  auto h2 = static_cast<uint32_t>(h >> 32) | 1;
+
+  std::lock_guard<std::mutex> lck{mutex_};
+  auto &db = *dbs_[dbIndex];
+  uint32_t estimate = UINT32_MAX;
+  for (int i = 0; i < kDepth; ++i) {
+    auto &counter = db.counters[i][(h1 + i * h2) % kWidth];
+    estimate = std::min(estimate, ++counter);
+  }
+
+  using KeyCount = Database::KeyCount;
+  auto it = std::find_if(db.top.begin(), db.top.end(),
+                         [&key](const KeyCount &e) { return e.first == key; });
+  if (it != db.top.end()) {
+    it->second = estimate;
+  } else if (db.top.size() < kTopK) {
+    db.top.emplace_back(key, estimate);
+  } else {
+    auto min = std::min_element(db.top.begin(), db.top.end(),
+                                [](const KeyCount &lhs, const KeyCount &rhs) {
+                                  return lhs.second < rhs.second;
+                                });
+    if (estimate > min->second) {
+      min->first = key;
+      min->second = estimate;
+    }
+  }
+
+  if (++db.samples >= kDecayPeriod) {
+    db.samples = 0;
+    for (auto &row : db.counters) {
+      for (auto &counter : row) {
+        counter >>= 1;
+      }
+    }
+    for (auto &e : db.top) {
+      e.second >>= 1;
+    }
+  }
+}
+
+uint32_t HotKeys::nextGap() const {
+  if (sample_interval_ == 1) {
+    return 0;
+  }
+  // xorshift64
+  thread_local uint64_t state =
+      0x9e3779b97f4a7c15ULL ^ reinterpret_cast<uintptr_t>(&state);
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return static_cast<uint32_t>(state % (2 * sample_interval_ - 1));
+}
+
+std::vector<std::pair<std::string, uint64_t>>
+HotKeys::top(int dbIndex, size_t count) const {
+  std::vector<std::pair<std::string, uint64_t>> result;
+  {
+    std::lock_guard<std::mutex> lck{mutex_};
+    for (const auto &e : dbs_[dbIndex]->top) {
+      if (e.second > 0) {
+        result.emplace_back(e.first,
+                            static_cast<uint64_t>(e.second) * sample_interval_);
+      }
+    }
+  }
+  std::sort(result.begin(), result.end(),
+            [](const std::pair<std::string, uint64_t> &lhs,
+               const std::pair<std::string, uint64_t> &rhs) {
+              return lhs.second > rhs.second;
+            });
+  if (result.size() > count) {
+    result.resize(count);
+  }
+  return result;
+}
+
+} // namespace bamboo
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "base/Macro.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bamboo {
+
+// finds the most requested keys of every database
+// one in sampleInterval() requests is counted in a count-min sketch, the
+// keys with the highest estimates are kept in a small top-K set; counts
+// are halved regularly so old hot keys fade out; memory is constant
+class HotKeys {
+public:
+  static constexpr int kDepth = 4;
+  static constexpr size_t kWidth = 1024;
+  static constexpr size_t kTopK = 16;
+  // halve all counts after this many samples of a database
+  static constexpr uint32_t kDecayPeriod = 1 << 16;
+
+  HotKeys(int numDatabases, uint32_t sampleInterval = 16);
+
+  DISALLOW_COPY(HotKeys)
+
+  ~HotKeys();
+
+  // called for every key access, cheap unless sampled
+  void touch(int dbIndex, const std::string &key) {
+    thread_local uint32_t countdown = 0;
+    if (countdown > 0) {
+      --countdown;
+      return;
+    }
+    // random gaps averaging sampleInterval(), a fixed stride would
+    // miss keys of periodic access patterns
+    countdown = nextGap();
+    sample(dbIndex, key);
+  }
+
+  // hottest keys first, with estimated request counts
+  std::vector<std::pair<std::string, uint64_t>> top(int dbIndex,
+                                                    size_t count) const;
+
+  uint32_t sampleInterval() const { return sample_interval_; }
+
+private:
+  struct Database;
+
+  void sample(int dbIndex, const std::string &key);
+
+  uint32_t nextGap() const;
+
+  const uint32_t sample_interval_;
+  // sampled requests are rare, a mutex is cheap enough
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Database>> dbs_; // guarded by mutex_
+};
+
+} // namespace bamboo
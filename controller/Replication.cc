@@ -0,0 +1,91 @@
+#include "controller/Replication.h"
+
+#include "controller/Coding.h"
+
+#include <leveldb/write_batch.h>
+
+namespace {
+
+constexpr char kTypePut = 1;
+constexpr char kTypeDelete = 2;
+
+// serialize operations of a leveldb::WriteBatch
+class BatchEncoder : public leveldb::WriteBatch::Handler {
+public:
+  explicit BatchEncoder(std::string *dst) : dst_(dst) {}
+
+  void Put(const leveldb::Slice &key, const leveldb::Slice &value) override {
+    dst_->push_back(kTypePut);
+    bamboo::coding::putLengthPrefixed(dst_, key.data(), key.size());
+    bamboo::coding::putLengthPrefixed(dst_, value.data(), value.size());
+  }
+
+  void Delete(const leveldb::Slice &key) override {
+    dst_->push_back(kTypeDelete);
+    bamboo::coding::putLengthPrefixed(dst_, key.data(), key.size());
+  }
+
+private:
+  std::string *dst_;
+};
+
+} // namespace
+
+namespace bamboo {
+namespace replication {
+
+bool appendFrame(std::string *dst, FrameType type, const char *payload,
+                 size_t len) {
+  if (len > kMaxFrameLength) {
+    return false;
+  }
+  coding::putFixed32(dst, static_cast<uint32_t>(len));
+  dst->push_back(type);
+  dst->append(payload, len);
+  return true;
+}
+
+void encodeWriteBatch(std::string *dst, int dbIndex,
+                      const leveldb::WriteBatch &batch) {
+  coding::putVarint32(dst, static_cast<uint32_t>(dbIndex));
+  BatchEncoder encoder(dst);
+  batch.Iterate(&encoder);
+}
+
+bool decodeWriteBatch(const char *payload, size_t len, int *dbIndex,
+                      leveldb::WriteBatch *batch) {
+  const char *limit = payload + len;
+  uint32_t index = 0;
+  const char *p = coding::getVarint32(payload, limit, &index);
+  if (p == nullptr) {
+    return false;
+  }
+  *dbIndex = static_cast<int>(index);
+
+  while (p < limit) {
+    char type = *p++;
+    const char *key;
+    uint32_t key_len;
+    p = coding::getLengthPrefixed(p, limit, &key, &key_len);
+    if (p == nullptr) {
+      return false;
+    }
+    if (type == kTypePut) {
+      const char *value;
+      uint32_t value_len;
+      p = coding::getLengthPrefixed(p, limit, &value, &value_len);
+      if (p == nullptr) {
+        return false;
+      }
+      batch->Put(leveldb::Slice(key, key_len), leveldb::Slice(value, value_len));
+    } else if (type == kTypeDelete) {
+      batch->Delete(leveldb::Slice(key, key_len));
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace replication
+} // namespace bamboo
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+namespace leveldb {
+class WriteBatch;
+}
+
+namespace bamboo {
+namespace replication {
+
+/// Replication stream sent by the primary after a replica sends "SYNC\n".
+///
+/// @code
+/// +---------------+--------+-----------------+
+/// | payload bytes |  type  |     payload     |
+/// |    fixed32    | 1 byte |                 |
+/// +---------------+--------+-----------------+
+/// @endcode
+///
+/// The stream starts with the dump of every database (see DumpFile.h), each
+/// sent as kSnapshot frames of at most kSnapshotPieceSize bytes that are
+/// concatenated up to a kSnapshotEnd frame. A kSyncDone frame follows the
+/// last dump, then a kWriteBatch frame for every write applied on the
+/// primary.
+enum FrameType : char {
+  kSnapshot = 1,
+  kSyncDone = 2,
+  kWriteBatch = 3,
+  kSnapshotEnd = 4,
+};
+
+constexpr size_t kFrameHeaderSize = 4 + 1;
+
+// largest payload the fixed32 length can describe
+constexpr size_t kMaxFrameLength = UINT32_MAX;
+
+constexpr size_t kSnapshotPieceSize = 256 * 1024;
+
+// command a replica sends to start replication
+constexpr char kSyncCommand[] = "SYNC";
+
+// return false and append nothing if len is over kMaxFrameLength
+bool appendFrame(std::string *dst, FrameType type, const char *payload,
+                 size_t len);
+
+// payload of kWriteBatch: varint32 db index, then put/delete records
+void encodeWriteBatch(std::string *dst, int dbIndex,
+                      const leveldb::WriteBatch &batch);
+
+// return false if payload is malformed
+bool decodeWriteBatch(const char *payload, size_t len, int *dbIndex,
+                      leveldb::WriteBatch *batch);
+
+} // namespace replication
+} // namespace bamboo
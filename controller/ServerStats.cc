@@ -0,0 +1,63 @@
+#include "controller/ServerStats.h"
+
+#include <string.h>
+
+namespace bamboo {
+
+namespace {
+struct CommandEntry {
+  const char *upper;
+  const char *lower;
+};
+
+// indexed by Command
+const CommandEntry kCommands[kNumCommands] = {
+    {"GET", "get"},         {"SET", "set"},
+    {"DEL", "del"},         {"MGET", "mget"},
+    {"MSET", "mset"},       {"LIST", "list"},
+    {"SELECT", "select"},   {"SAVE", "save"},
+    {"BGSAVE", "bgsave"},   {"CURRENTDB", "currentdb"},
+    {"INFO", "info"},       {"SLOWLOG", "slowlog"},
+    {"HOTKEYS", "hotkeys"}, {"HELP", "help"},
+    {"", "unknown"},
+};
+} // namespace
+
+constexpr double ServerStats::kSampleInterval;
+
+Command commandOf(const std::string &cmd) {
+  for (int i = 0; i < kCmdUnknown; ++i) {
+    if (::strcmp(cmd.c_str(), kCommands[i].upper) == 0) {
+      return static_cast<Command>(i);
+    }
+  }
+  return kCmdUnknown;
+}
+
+const char *commandName(Command command) { return kCommands[command].lower; }
+
+void ServerStats::sample() {
+  for (auto &counter : commands_) {
+    uint64_t calls = counter.calls.load(std::memory_order_relaxed);
+    counter.ops_per_sec.store(
+        static_cast<uint64_t>((calls - counter.last_calls) / kSampleInterval),
+        std::memory_order_relaxed);
+    counter.last_calls = calls;
+  }
+}
+
+int64_t ServerStats::uptimeSeconds() const {
+  return (TimeStamp::coarseNow().microSecondsSinceEpoch() -
+          start_time_.microSecondsSinceEpoch()) /
+         TimeStamp::kMicroSecondsPerSecond;
+}
+
+uint64_t ServerStats::totalCalls() const {
+  uint64_t total = 0;
+  for (const auto &counter : commands_) {
+    total += counter.calls.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+} // namespace bamboo
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "base/Histogram.h"
+#include "base/Macro.h"
+#include "base/TimeStamp.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+namespace bamboo {
+
+// commands of the text protocol
+enum Command {
+  kCmdGet,
+  kCmdSet,
+  kCmdDel,
+  kCmdMget,
+  kCmdMset,
+  kCmdList,
+  kCmdSelect,
+  kCmdSave,
+  kCmdBgsave,
+  kCmdCurrentDb,
+  kCmdInfo,
+  kCmdSlowlog,
+  kCmdHotkeys,
+  kCmdHelp,
+  kCmdUnknown,
+  kNumCommands,
+};
+
+Command commandOf(const std::string &cmd);
+
+// lower case, e.g. "get"
+const char *commandName(Command command);
+
+// counters of a server
+// updated in loop threads with relaxed atomics, read from any thread
+class ServerStats {
+public:
+  ServerStats() : start_time_(TimeStamp::now()) {}
+
+  DISALLOW_COPY(ServerStats)
+
+  void onCommand(Command command) {
+    commands_[command].calls.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void onConnection(bool connected) {
+    if (connected) {
+      connected_clients_.fetch_add(1, std::memory_order_relaxed);
+      total_connections_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      connected_clients_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  // from receive time to the response handed to send
+  void recordLatency(Command command, int64_t micros) {
+    latencies_.record(command, micros > 0 ? static_cast<uint64_t>(micros) : 0);
+  }
+
+  void addBytesIn(size_t n) {
+    bytes_in_.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  void addBytesOut(size_t n) {
+    bytes_out_.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  // update ops per second, called every kSampleInterval seconds
+  // by a single thread
+  void sample();
+
+  TimeStamp startTime() const { return start_time_; }
+
+  int64_t uptimeSeconds() const;
+
+  int64_t connectedClients() const {
+    return connected_clients_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t totalConnections() const {
+    return total_connections_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t bytesIn() const { return bytes_in_.load(std::memory_order_relaxed); }
+
+  uint64_t bytesOut() const {
+    return bytes_out_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t calls(Command command) const {
+    return commands_[command].calls.load(std::memory_order_relaxed);
+  }
+
+  uint64_t totalCalls() const;
+
+  // calls per second over the last sample interval
+  uint64_t opsPerSecond(Command command) const {
+    return commands_[command].ops_per_sec.load(std::memory_order_relaxed);
+  }
+
+  // latency in microseconds, merged from all threads
+  Histogram latency(Command command) const {
+    return latencies_.merged(command);
+  }
+
+  static constexpr double kSampleInterval = 1.0;
+
+private:
+  struct CommandCounter {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> ops_per_sec{0};
+    // calls at the last sample, only used by sample()
+    uint64_t last_calls{0};
+  };
+
+  const TimeStamp start_time_;
+  std::atomic<int64_t> connected_clients_{0};
+  std::atomic<uint64_t> total_connections_{0};
+  std::atomic<uint64_t> bytes_in_{0};
+  std::atomic<uint64_t> bytes_out_{0};
+  CommandCounter commands_[kNumCommands];
+  ShardedHistograms latencies_{kNumCommands};
+};
+
+} // namespace bamboo
@@ -0,0 +1,110 @@
+#include "controller/SlowLog.h"
+
+#include <algorithm>
+
+#include <string.h>
+
+namespace bamboo {
+
+constexpr size_t SlowLog::kMaxCommandLength;
+constexpr size_t SlowLog::kMaxClientLength;
+
+// guarded by a sequence lock: odd while being written
+struct SlowLog::Slot {
+  std::atomic<uint64_t> seq{0};
+  uint64_t id;
+  int64_t start_time;
+  int64_t duration;
+  int db_index;
+  uint32_t command_len;
+  uint32_t command_dropped;
+  char command[kMaxCommandLength];
+  char client[kMaxClientLength + 1];
+};
+
+SlowLog::SlowLog(size_t capacity)
+    : capacity_(capacity), slots_(new Slot[capacity]) {}
+
+SlowLog::~SlowLog() = default;
+
+void SlowLog::add(int64_t startTime, int64_t duration, int dbIndex,
+                  const std::string &command, const std::string &client) {
+  uint64_t id = next_id_.fetch_add(1, std::memory_order_relaxed);
+  Slot &slot = slots_[id % capacity_];
+
+  uint64_t seq = slot.seq.load(std::memory_order_relaxed);
+  if ((seq & 1) != 0 ||
+      !slot.seq.compare_exchange_strong(seq, seq + 1,
+                                        std::memory_order_acquire)) {
+    return;
+  }
+
+  slot.id = id;
+  slot.start_time = startTime;
+  slot.duration = duration;
+  slot.db_index = dbIndex;
+  size_t len = std::min(command.size(), kMaxCommandLength);
+  ::memcpy(slot.command, command.data(), len);
+  slot.command_len = static_cast<uint32_t>(len);
+  slot.command_dropped = static_cast<uint32_t>(command.size() - len);
+  size_t client_len = std::min(client.size(), kMaxClientLength);
+  ::memcpy(slot.client, client.data(), client_len);
+  slot.client[client_len] = '\0';
+
+  slot.seq.store(seq + 2, std::memory_order_release);
+}
+
+std::vector<SlowLog::Entry> SlowLog::get(size_t count) const {
+  std::vector<Entry> entries;
+  uint64_t reset_id = reset_id_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < capacity_; ++i) {
+    const Slot &slot = slots_[i];
+    uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq == 0 || (seq & 1) != 0) {
+      // empty or being written
+      continue;
+    }
+
+    Entry entry;
+    entry.id = slot.id;
+    entry.start_time = slot.start_time;
+    entry.duration = slot.duration;
+    entry.db_index = slot.db_index;
+    uint32_t len = std::min<uint32_t>(slot.command_len, kMaxCommandLength);
+    entry.command.assign(slot.command, len);
+    uint32_t dropped = slot.command_dropped;
+    entry.client.assign(slot.client,
+                        ::strnlen(slot.client, kMaxClientLength + 1));
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != seq ||
+        entry.id < reset_id) {
+      continue;
+    }
+    if (dropped > 0) {
+      entry.command += "... (" + std::to_string(dropped) + " more bytes)";
+    }
+    entries.push_back(std::move(entry));
+  }
+
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &lhs, const Entry &rhs) { return lhs.id > rhs.id; });
+  if (entries.size() > count) {
+    entries.resize(count);
+  }
+  return entries;
+}
+
+size_t SlowLog::size() const {
+  uint64_t next_id = next_id_.load(std::memory_order_relaxed);
+  uint64_t reset_id = reset_id_.load(std::memory_order_relaxed);
+  return static_cast<size_t>(
+      std::min<uint64_t>(next_id - std::min(next_id, reset_id), capacity_));
+}
+
+void SlowLog::reset() {
+  reset_id_.store(next_id_.load(std::memory_order_relaxed),
+                  std::memory_order_relaxed);
+}
+
+} // namespace bamboo
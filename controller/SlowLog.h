@@ -0,0 +1,79 @@
+#pragma once
+
+#include "base/Macro.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bamboo {
+
+// recent commands slower than a threshold, kept in a bounded ring
+// add() is lock free and may be called from any thread; a writer that
+// finds its slot being written by another one drops its entry
+class SlowLog {
+public:
+  struct Entry {
+    uint64_t id;
+    // micro seconds since epoch
+    int64_t start_time;
+    int64_t duration;
+    int db_index;
+    // command and arguments, truncated
+    std::string command;
+    std::string client;
+  };
+
+  // longer commands are cut and marked with the number of bytes dropped
+  static constexpr size_t kMaxCommandLength = 128;
+  static constexpr size_t kMaxClientLength = 63;
+
+  explicit SlowLog(size_t capacity = 128);
+
+  DISALLOW_COPY(SlowLog)
+
+  ~SlowLog();
+
+  // in micro seconds, negative disables the log
+  void setThreshold(int64_t micros) {
+    threshold_.store(micros, std::memory_order_relaxed);
+  }
+
+  int64_t threshold() const {
+    return threshold_.load(std::memory_order_relaxed);
+  }
+
+  bool slow(int64_t duration) const {
+    int64_t threshold = this->threshold();
+    return threshold >= 0 && duration >= threshold;
+  }
+
+  void add(int64_t startTime, int64_t duration, int dbIndex,
+           const std::string &command, const std::string &client);
+
+  // at most count entries, newest first
+  std::vector<Entry> get(size_t count) const;
+
+  // entries added and not reset, at most capacity
+  size_t size() const;
+
+  size_t capacity() const { return capacity_; }
+
+  void reset();
+
+private:
+  struct Slot;
+
+  const size_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<int64_t> threshold_{10000};
+  std::atomic<uint64_t> next_id_{0};
+  // entries before it are hidden
+  std::atomic<uint64_t> reset_id_{0};
+};
+
+} // namespace bamboo
@@ -73,6 +73,12 @@ void AsyncLogging::threadFunc() {
                buffers_to_write.size() - 2);
       fputs(buf, stderr);
       output.append(buf, strlen(buf));
+      for (auto it = buffers_to_write.begin() + 2; it != buffers_to_write.end();
+           ++it) {
+        dropped_bytes_.fetch_add((*it)->length(), std::memory_order_relaxed);
+      }
+      dropped_buffers_.fetch_add(buffers_to_write.size() - 2,
+                                 std::memory_order_relaxed);
       buffers_to_write.erase(buffers_to_write.begin() + 2,
                              buffers_to_write.end());
     }
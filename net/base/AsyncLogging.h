@@ -39,6 +39,15 @@ public:
     thread_.join();
   }
 
+  // buffers dropped because the backend could not keep up
+  uint64_t droppedBuffers() const {
+    return dropped_buffers_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t droppedBytes() const {
+    return dropped_bytes_.load(std::memory_order_relaxed);
+  }
+
 private:
   void threadFunc();
 
@@ -57,6 +66,8 @@ private:
   BufferPtr cur_buffer_{new Buffer};         // Guarded by mutex_
   BufferPtr next_buffer_{new Buffer};        // Guarded by mutex_
   BufferVector buffers_{};         // Guarded by mutex_
+  std::atomic<uint64_t> dropped_buffers_{0};
+  std::atomic<uint64_t> dropped_bytes_{0};
 };
 
 } // namespace bamboo
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "base/ByteScan.h"
+
+#include <string.h>
+
+#include <atomic>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace bamboo {
+namespace ByteScan {
+
+namespace {
+
+using FindFn = const char *(*)(const char *, const char *, char);
+
+#if defined(__x86_64__)
+// sse2 is part of x86_64
+const char *findSse2(const char *p, const char *end, char c) {
+  const __m128i needle = _mm_set1_epi8(c);
+  for (; end - p >= 16; p += 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+  for (; p < end; ++p) {
+    if (*p == c) {
+      return p;
+    }
+  }
+  return nullptr;
+}
+
+__attribute__((target("avx2"))) const char *
+findAvx2(const char *p, const char *end, char c) {
+  const __m256i needle = _mm256_set1_epi8(c);
+  for (; end - p >= 32; p += 32) {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    __m256i eq = _mm256_cmpeq_epi8(block, needle);
+    auto mask = static_cast<unsigned>(_mm256_movemask_epi8(eq));
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+  return findSse2(p, end, c);
+}
+
+FindFn select() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") ? &findAvx2 : &findSse2;
+}
+#else
+const char *findScalar(const char *begin, const char *end, char c) {
+  return static_cast<const char *>(memchr(begin, c, end - begin));
+}
+
+FindFn select() { return &findScalar; }
+#endif
+
+const char *findFirstCall(const char *begin, const char *end, char c);
+
+// constant initialized, so a call during static initialization of another
+// translation unit still resolves
+std::atomic<FindFn> g_find{&findFirstCall};
+
+const char *findFirstCall(const char *begin, const char *end, char c) {
+  FindFn find = select();
+  g_find.store(find, std::memory_order_relaxed);
+  return find(begin, end, c);
+}
+
+} // namespace
+
+const char *find(const char *begin, const char *end, char c) {
+  return g_find.load(std::memory_order_relaxed)(begin, end, c);
+}
+
+const char *findCRLF(const char *begin, const char *end) {
+  // look for the '\n' ending the pair, '\r' alone is rare in commands
+  const char *p = begin + 1;
+  while (p < end && (p = find(p, end, '\n')) != nullptr) {
+    if (p[-1] == '\r') {
+      return p - 1;
+    }
+    ++p;
+  }
+  return nullptr;
+}
+
+const char *implementation() {
+#if defined(__x86_64__)
+  return select() == &findAvx2 ? "avx2" : "sse2";
+#else
+  return "scalar";
+#endif
+}
+
+} // namespace ByteScan
+} // namespace bamboo
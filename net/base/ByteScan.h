@@ -0,0 +1,17 @@
+#pragma once
+
+namespace bamboo {
+namespace ByteScan {
+
+// first c in [begin, end), or null; AVX2 or SSE2 as the cpu supports,
+// chosen on the first call
+const char *find(const char *begin, const char *end, char c);
+
+// first "\r\n" in [begin, end), or null
+const char *findCRLF(const char *begin, const char *end);
+
+// name of the implementation in use, "avx2", "sse2" or "scalar"
+const char *implementation();
+
+} // namespace ByteScan
+} // namespace bamboo
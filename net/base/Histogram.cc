@@ -0,0 +1,122 @@
+#include "base/Histogram.h"
+
+#include <algorithm>
+
+namespace bamboo {
+
+constexpr int Histogram::kSubBucketBits;
+constexpr int Histogram::kSubBucketCount;
+constexpr int Histogram::kSubBucketHalfCount;
+constexpr int Histogram::kMaxValueBits;
+constexpr uint64_t Histogram::kMaxValue;
+constexpr int Histogram::kNumBuckets;
+
+uint64_t Histogram::lowerBound(int bucket) {
+  if (bucket < kSubBucketCount) {
+    return static_cast<uint64_t>(bucket);
+  }
+  int index = bucket - kSubBucketCount;
+  int shift = index / kSubBucketHalfCount + 1;
+  uint64_t sub = index % kSubBucketHalfCount + kSubBucketHalfCount;
+  return sub << shift;
+}
+
+void Histogram::merge(const Histogram &that) {
+  for (int i = 0; i < kNumBuckets; ++i) {
+    counts_[i] += that.counts_[i];
+  }
+  count_ += that.count_;
+  sum_ += that.sum_;
+  max_ = std::max(max_, that.max_);
+}
+
+void Histogram::reset() {
+  std::fill(counts_.begin(), counts_.end(), 0);
+  count_ = 0;
+  sum_ = 0;
+  max_ = 0;
+}
+
+uint64_t Histogram::percentile(double p) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  // rank of the value, 1 based
+  auto rank = static_cast<uint64_t>(p / 100.0 * count_ + 0.5);
+  rank = std::max<uint64_t>(1, std::min(rank, count_));
+  uint64_t seen = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      return std::min(upperBound(i), max_);
+    }
+  }
+  return max_;
+}
+
+uint64_t Histogram::countAtOrBelow(uint64_t value) const {
+  int last = bucketOf(value);
+  uint64_t count = 0;
+  for (int i = 0; i <= last; ++i) {
+    count += counts_[i];
+  }
+  return count;
+}
+
+std::atomic<int> ShardedHistograms::next_id_{0};
+thread_local std::vector<ShardedHistograms::Shard *>
+    ShardedHistograms::tls_shards_;
+
+ShardedHistograms::Shard::Shard(int size)
+    : buckets(new std::atomic<uint64_t>[static_cast<size_t>(size) *
+                                        Histogram::kNumBuckets]),
+      sums(new std::atomic<uint64_t>[size]),
+      maxes(new std::atomic<uint64_t>[size]) {
+  for (size_t i = 0; i < static_cast<size_t>(size) * Histogram::kNumBuckets;
+       ++i) {
+    buckets[i].store(0, std::memory_order_relaxed);
+  }
+  for (int i = 0; i < size; ++i) {
+    sums[i].store(0, std::memory_order_relaxed);
+    maxes[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+ShardedHistograms::ShardedHistograms(int size)
+    : size_(size), id_(next_id_.fetch_add(1)) {}
+
+ShardedHistograms::~ShardedHistograms() = default;
+
+Histogram ShardedHistograms::merged(int index) const {
+  Histogram result;
+  std::lock_guard<std::mutex> lck{mutex_};
+  for (const auto &shard : shards_) {
+    auto *h =
+        &shard->buckets[static_cast<size_t>(index) * Histogram::kNumBuckets];
+    for (int i = 0; i < Histogram::kNumBuckets; ++i) {
+      uint64_t count = h[i].load(std::memory_order_relaxed);
+      if (count > 0) {
+        result.addBucket(i, count);
+      }
+    }
+    result.addSummary(shard->sums[index].load(std::memory_order_relaxed),
+                      shard->maxes[index].load(std::memory_order_relaxed));
+  }
+  return result;
+}
+
+ShardedHistograms::Shard &ShardedHistograms::addShard() {
+  std::unique_ptr<Shard> shard(new Shard(size_));
+  Shard *ptr = shard.get();
+  {
+    std::lock_guard<std::mutex> lck{mutex_};
+    shards_.push_back(std::move(shard));
+  }
+  if (tls_shards_.size() <= static_cast<size_t>(id_)) {
+    tls_shards_.resize(id_ + 1, nullptr);
+  }
+  tls_shards_[id_] = ptr;
+  return *ptr;
+}
+
+} // namespace bamboo
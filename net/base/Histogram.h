@@ -0,0 +1,173 @@
+#pragma once
+
+#include "base/Macro.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace bamboo {
+
+// log-linear histogram in the style of HdrHistogram
+// values below 2^kSubBucketBits have their own bucket, above that every
+// power of two is split into 2^(kSubBucketBits - 1) buckets, so a bucket
+// is at most ~3% wide; memory is fixed
+// not thread safe
+class Histogram {
+public:
+  static constexpr int kSubBucketBits = 6;
+  static constexpr int kSubBucketCount = 1 << kSubBucketBits;
+  static constexpr int kSubBucketHalfCount = kSubBucketCount / 2;
+  // larger values are recorded as kMaxValue
+  static constexpr int kMaxValueBits = 36;
+  static constexpr uint64_t kMaxValue = (uint64_t(1) << kMaxValueBits) - 1;
+  static constexpr int kNumBuckets =
+      kSubBucketCount +
+      (kMaxValueBits - kSubBucketBits) * kSubBucketHalfCount;
+
+  static int bucketOf(uint64_t value) {
+    if (value > kMaxValue) {
+      value = kMaxValue;
+    }
+    if (value < kSubBucketCount) {
+      return static_cast<int>(value);
+    }
+    // value in [2^(msb), 2^(msb+1)), keep its top kSubBucketBits bits
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - kSubBucketBits + 1;
+    return kSubBucketCount + (shift - 1) * kSubBucketHalfCount +
+           static_cast<int>(value >> shift) - kSubBucketHalfCount;
+  }
+
+  // smallest value of bucket
+  static uint64_t lowerBound(int bucket);
+
+  // largest value of bucket
+  static uint64_t upperBound(int bucket) {
+    return bucket + 1 < kNumBuckets ? lowerBound(bucket + 1) - 1 : kMaxValue;
+  }
+
+  Histogram() : counts_(kNumBuckets) {}
+
+  void record(uint64_t value) {
+    ++counts_[bucketOf(value)];
+    ++count_;
+    sum_ += value;
+    if (value > max_) {
+      max_ = value;
+    }
+  }
+
+  // add count values of bucket, their sum and max go to addSummary()
+  void addBucket(int bucket, uint64_t count) {
+    counts_[bucket] += count;
+    count_ += count;
+  }
+
+  void addSummary(uint64_t sum, uint64_t max) {
+    sum_ += sum;
+    if (max > max_) {
+      max_ = max;
+    }
+  }
+
+  void merge(const Histogram &that);
+
+  void reset();
+
+  uint64_t count() const { return count_; }
+
+  uint64_t sum() const { return sum_; }
+
+  uint64_t max() const { return max_; }
+
+  double mean() const {
+    return count_ > 0 ? static_cast<double>(sum_) / count_ : 0.0;
+  }
+
+  // e.g. percentile(99.9), upper bound of the bucket holding the value,
+  // 0 if empty
+  uint64_t percentile(double p) const;
+
+  uint64_t countOf(int bucket) const { return counts_[bucket]; }
+
+  // values up to the bucket holding value, for cumulative buckets; exact
+  // for the upperBound() of a bucket, otherwise it counts the values of
+  // the whole bucket, up to ~3% above value
+  uint64_t countAtOrBelow(uint64_t value) const;
+
+private:
+  std::vector<uint64_t> counts_;
+  uint64_t count_{0};
+  uint64_t sum_{0};
+  uint64_t max_{0};
+};
+
+// a group of histograms recorded by many threads
+// every thread records into its own shard without locking, readers merge
+// all shards; the shard of a thread lives as long as the group
+class ShardedHistograms {
+public:
+  explicit ShardedHistograms(int size);
+
+  DISALLOW_COPY(ShardedHistograms)
+
+  ~ShardedHistograms();
+
+  int size() const { return size_; }
+
+  // record value into histogram index, lock free
+  void record(int index, uint64_t value) {
+    auto &shard = localShard();
+    auto *h = &shard.buckets[static_cast<size_t>(index) *
+                             Histogram::kNumBuckets];
+    int bucket = Histogram::bucketOf(value);
+    // single writer, a plain load and store is enough
+    h[bucket].store(h[bucket].load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+    auto &sum = shard.sums[index];
+    sum.store(sum.load(std::memory_order_relaxed) + value,
+              std::memory_order_relaxed);
+    auto &max = shard.maxes[index];
+    if (value > max.load(std::memory_order_relaxed)) {
+      max.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  // all shards merged
+  Histogram merged(int index) const;
+
+private:
+  struct Shard {
+    explicit Shard(int size);
+
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+    std::unique_ptr<std::atomic<uint64_t>[]> sums;
+    std::unique_ptr<std::atomic<uint64_t>[]> maxes;
+  };
+
+  Shard &localShard() {
+    auto &cache = tls_shards_;
+    if (static_cast<size_t>(id_) < cache.size() && cache[id_] != nullptr) {
+      return *cache[id_];
+    }
+    return addShard();
+  }
+
+  Shard &addShard();
+
+  const int size_;
+  // never reused, indexes thread local shard caches
+  const int id_;
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Shard>> shards_; // guarded by mutex_
+
+  static std::atomic<int> next_id_;
+  static thread_local std::vector<Shard *> tls_shards_;
+};
+
+} // namespace bamboo
@@ -3,6 +3,7 @@
 #include "base/CurrentThread.h"
 
 #include "assert.h"
+#include <time.h>
 
 namespace {
 // print message to stdout
@@ -69,7 +70,7 @@ Logger::~Logger() {
 }
 
 Logger::Impl::Impl(LogLevel level, int savedErrno, const char *file, int line)
-    : time_(TimeStamp::now()), level_(level), line_(line), basename_(file) {
+    : time_(TimeStamp::coarseNow()), level_(level), line_(line), basename_(file) {
   formatTime();
   stream_ << " " << CurrentThread::tid();
   stream_ << " " << LogLevelName[level];
@@ -84,7 +85,7 @@ void Logger::Impl::formatTime() {
   if (seconds != t_lastsecond) {
     t_lastsecond = seconds;
     struct tm tm_time;
-    ::gmtime_r(&microSecondsSinceEpoch, &tm_time);
+    ::gmtime_r(&seconds, &tm_time);
     int len =
         snprintf(t_time, sizeof(t_time), "%4d-%02d-%02d %02d:%02d:%02d",
                  tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "base/Macro.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <utility>
+
+namespace bamboo {
+
+// unbounded lock-free multi-producer single-consumer queue
+// (Dmitry Vyukov's intrusive MPSC node queue)
+// push() is lock-free and may be called from any thread; pop() and
+// consume() must only be called by the one consumer thread. Items pushed
+// by one producer are consumed in order.
+// Consumed nodes go to a free list that producers take them from, so a
+// queue that reached its working depth stops allocating. One producer at a
+// time pops the free list, which keeps the pop free of ABA; the others
+// allocate instead of waiting.
+// T must be default constructible and movable.
+template <typename T> class MpscQueue {
+public:
+  MpscQueue() : head_(new Node) {
+    tail_ = head_.load(std::memory_order_relaxed);
+  }
+
+  DISALLOW_COPY(MpscQueue)
+
+  ~MpscQueue() {
+    T value;
+    while (pop(&value)) {
+    }
+    delete tail_;
+    Node *node = free_.load(std::memory_order_relaxed);
+    while (node != nullptr) {
+      Node *next = node->next.load(std::memory_order_relaxed);
+      delete node;
+      node = next;
+    }
+  }
+
+  void push(T value) {
+    Node *node = takeFreeNode();
+    if (node == nullptr) {
+      node = new Node(std::move(value));
+    } else {
+      node->value = std::move(value);
+    }
+    size_.fetch_add(1, std::memory_order_relaxed);
+    Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+    // between the exchange and this store the consumer sees the queue
+    // end at prev; seq_cst so a consumer that clears a "wakeup pending"
+    // flag before consuming and a producer that sets it after pushing
+    // cannot both miss each other
+    prev->next.store(node, std::memory_order_seq_cst);
+  }
+
+  // return false if empty, or the next item is not linked yet
+  bool pop(T *value) {
+    Node *next = tail_->next.load(std::memory_order_seq_cst);
+    if (next == nullptr) {
+      return false;
+    }
+    *value = std::move(next->value);
+    recycle(tail_);
+    tail_ = next;
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // pop at most max items pushed before the call and pass each to f,
+  // items pushed meanwhile (e.g. by f) are left for the next call
+  // return number of items consumed
+  template <typename F> size_t consume(F &&f, size_t max = SIZE_MAX) {
+    Node *last = head_.load(std::memory_order_seq_cst);
+    size_t n = 0;
+    T value;
+    while (n < max && tail_ != last && pop(&value)) {
+      f(value);
+      value = T();
+      ++n;
+    }
+    return n;
+  }
+
+  // approximate when producers are active
+  size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+  bool empty() const { return size() == 0; }
+
+  // nodes kept for reuse, approximate
+  size_t freeNodes() const {
+    return free_count_.load(std::memory_order_relaxed);
+  }
+
+  // nodes beyond this are deleted instead of kept
+  static constexpr size_t kMaxFreeNodes = 4096;
+
+private:
+  struct Node {
+    Node() = default;
+
+    explicit Node(T &&v) : value(std::move(v)) {}
+
+    std::atomic<Node *> next{nullptr};
+    T value;
+  };
+
+  static constexpr size_t kCacheLineSize = 64;
+
+  // producer side, nullptr if the free list is empty or being popped
+  Node *takeFreeNode() {
+    if (free_popping_.exchange(true, std::memory_order_acquire)) {
+      return nullptr;
+    }
+    // the consumer only pushes, so with a single popper a node read as the
+    // top stays there with the same next until this pop takes it
+    Node *node = free_.load(std::memory_order_acquire);
+    while (node != nullptr &&
+           !free_.compare_exchange_weak(
+               node, node->next.load(std::memory_order_relaxed),
+               std::memory_order_acquire, std::memory_order_acquire)) {
+    }
+    free_popping_.store(false, std::memory_order_release);
+    if (node != nullptr) {
+      free_count_.fetch_sub(1, std::memory_order_relaxed);
+      node->next.store(nullptr, std::memory_order_relaxed);
+    }
+    return node;
+  }
+
+  // consumer side, node is the old stub
+  void recycle(Node *node) {
+    if (free_count_.load(std::memory_order_relaxed) >= kMaxFreeNodes) {
+      delete node;
+      return;
+    }
+    // release what the moved-from value may still hold
+    node->value = T();
+    free_count_.fetch_add(1, std::memory_order_relaxed);
+    Node *top = free_.load(std::memory_order_relaxed);
+    do {
+      node->next.store(top, std::memory_order_relaxed);
+    } while (!free_.compare_exchange_weak(top, node,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+  }
+
+  // producers, padded away from the consumer's tail_
+  std::atomic<Node *> head_;
+  std::atomic<size_t> size_{0};
+  std::atomic<Node *> free_{nullptr};
+  std::atomic<size_t> free_count_{0};
+  std::atomic<bool> free_popping_{false};
+  char pad_[kCacheLineSize];
+  // consumer, a stub whose value is already consumed
+  Node *tail_;
+};
+
+template <typename T> constexpr size_t MpscQueue<T>::kMaxFreeNodes;
+
+} // namespace bamboo
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "base/Macro.h"
+
+#include <stddef.h>
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace bamboo {
+
+template <typename Signature> class Task;
+
+// move only replacement of std::function for loop callbacks
+// callables up to kInlineSize bytes, e.g. a std::bind of a member function,
+// a TcpConnectionPtr and a std::string, are stored in place; larger ones or
+// ones that may throw when moved fall back to the heap
+template <typename R, typename... Args> class Task<R(Args...)> {
+public:
+  static constexpr size_t kInlineSize = 64;
+
+  // whether a callable of type F is stored without allocation
+  template <typename F> static constexpr bool storedInline() {
+    return sizeof(F) <= kInlineSize && alignof(F) <= alignof(Storage) &&
+           std::is_nothrow_move_constructible<F>::value;
+  }
+
+  Task() noexcept = default;
+
+  Task(std::nullptr_t) noexcept {} // NOLINT
+
+  template <typename F,
+            typename = typename std::enable_if<!std::is_same<
+                typename std::decay<F>::type, Task>::value>::type>
+  Task(F &&f) { // NOLINT
+    using Fn = typename std::decay<F>::type;
+    init<Fn>(std::forward<F>(f),
+             std::integral_constant<bool, storedInline<Fn>()>());
+  }
+
+  Task(Task &&that) noexcept { moveFrom(&that); }
+
+  Task &operator=(Task &&that) noexcept {
+    if (this != &that) {
+      reset();
+      moveFrom(&that);
+    }
+    return *this;
+  }
+
+  Task &operator=(std::nullptr_t) noexcept {
+    reset();
+    return *this;
+  }
+
+  DISALLOW_COPY(Task)
+
+  ~Task() { reset(); }
+
+  explicit operator bool() const noexcept { return invoke_ != nullptr; }
+
+  // like std::function, calling does not change the task itself
+  R operator()(Args... args) const {
+    return invoke_(const_cast<Storage *>(&storage_),
+                   std::forward<Args>(args)...);
+  }
+
+private:
+  using Storage = typename std::aligned_storage<kInlineSize>::type;
+  using Invoke = R (*)(void *, Args &&...);
+  // move the callable in src to dst and destroy src, or destroy src if dst
+  // is null
+  using Manage = void (*)(void *src, void *dst);
+
+  template <typename Fn, typename F> void init(F &&f, std::true_type) {
+    ::new (&storage_) Fn(std::forward<F>(f));
+    invoke_ = &invokeInline<Fn>;
+    manage_ = &manageInline<Fn>;
+  }
+
+  template <typename Fn, typename F> void init(F &&f, std::false_type) {
+    ::new (&storage_) Fn *(new Fn(std::forward<F>(f)));
+    invoke_ = &invokeHeap<Fn>;
+    manage_ = &manageHeap<Fn>;
+  }
+
+  template <typename Fn> static R invokeInline(void *p, Args &&... args) {
+    return (*static_cast<Fn *>(p))(std::forward<Args>(args)...);
+  }
+
+  template <typename Fn> static R invokeHeap(void *p, Args &&... args) {
+    return (**static_cast<Fn **>(p))(std::forward<Args>(args)...);
+  }
+
+  template <typename Fn> static void manageInline(void *src, void *dst) {
+    auto *f = static_cast<Fn *>(src);
+    if (dst != nullptr) {
+      ::new (dst) Fn(std::move(*f));
+    }
+    f->~Fn();
+  }
+
+  template <typename Fn> static void manageHeap(void *src, void *dst) {
+    // only the pointer moves, the callable stays where it is
+    auto **f = static_cast<Fn **>(src);
+    if (dst != nullptr) {
+      ::new (dst) Fn *(*f);
+    } else {
+      delete *f;
+    }
+  }
+
+  void moveFrom(Task *that) {
+    if (that->invoke_ == nullptr) {
+      return;
+    }
+    that->manage_(&that->storage_, &storage_);
+    invoke_ = that->invoke_;
+    manage_ = that->manage_;
+    that->invoke_ = nullptr;
+    that->manage_ = nullptr;
+  }
+
+  void reset() {
+    if (invoke_ == nullptr) {
+      return;
+    }
+    manage_(&storage_, nullptr);
+    invoke_ = nullptr;
+    manage_ = nullptr;
+  }
+
+  Storage storage_;
+  Invoke invoke_{nullptr};
+  Manage manage_{nullptr};
+};
+
+template <typename R, typename... Args>
+constexpr size_t Task<R(Args...)>::kInlineSize;
+
+} // namespace bamboo
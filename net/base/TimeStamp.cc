@@ -1,15 +1,33 @@
 #include "base/TimeStamp.h"
 
+#include <sys/time.h>
+#include <time.h>
+
 namespace bamboo {
 
-TimeStamp TimeStamp::now() { return TimeStamp(::time(NULL)); }
+TimeStamp TimeStamp::now() {
+  struct timeval tv;
+  ::gettimeofday(&tv, NULL);
+  return TimeStamp(static_cast<int64_t>(tv.tv_sec) * kMicroSecondsPerSecond +
+                   tv.tv_usec);
+}
+
+TimeStamp TimeStamp::coarseNow() {
+  struct timespec ts;
+  ::clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+  return TimeStamp(static_cast<int64_t>(ts.tv_sec) * kMicroSecondsPerSecond +
+                   ts.tv_nsec / 1000);
+}
 
 std::string TimeStamp::toString() const {
   char buf[128] = {0};
-  tm *tm_time = localtime(&microSecondSinceEpoch_);
-  snprintf(buf, 128, "%4d/%02d/%02d %02d:%02d:%02d", tm_time->tm_year + 1900,
-           tm_time->tm_mon + 1, tm_time->tm_mday, tm_time->tm_hour,
-           tm_time->tm_min, tm_time->tm_sec);
+  time_t seconds =
+      static_cast<time_t>(microSecondSinceEpoch_ / kMicroSecondsPerSecond);
+  struct tm tm_time;
+  localtime_r(&seconds, &tm_time);
+  snprintf(buf, 128, "%4d/%02d/%02d %02d:%02d:%02d", tm_time.tm_year + 1900,
+           tm_time.tm_mon + 1, tm_time.tm_mday, tm_time.tm_hour,
+           tm_time.tm_min, tm_time.tm_sec);
   return buf;
 }
 
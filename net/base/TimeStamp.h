@@ -28,6 +28,10 @@ public:
   // return current time
   static TimeStamp now();
 
+  // current time to a few milliseconds, CLOCK_REALTIME_COARSE is read from
+  // the vdso without touching the clock source; for logs and metrics
+  static TimeStamp coarseNow();
+
   // return invalid timestamp
   static TimeStamp getInvalid() { return TimeStamp(); }
 
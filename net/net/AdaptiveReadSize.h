@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+
+namespace bamboo {
+
+// bytes a connection makes room for before reading, following the sizes of
+// its recent reads: a read that fills the room doubles it, two reads in a
+// row under half of it halve it; not thread safe
+class AdaptiveReadSize {
+public:
+  static constexpr size_t kMinSize = 1024;
+  static constexpr size_t kMaxSize = 256 * 1024;
+
+  size_t next() const { return size_; }
+
+  void record(size_t bytes) {
+    if (bytes >= size_) {
+      size_ = size_ * 2 <= kMaxSize ? size_ * 2 : kMaxSize;
+      shrink_pending_ = false;
+    } else if (bytes < size_ / 2 && size_ > kMinSize) {
+      if (shrink_pending_) {
+        size_ /= 2;
+      }
+      shrink_pending_ = !shrink_pending_;
+    } else {
+      shrink_pending_ = false;
+    }
+  }
+
+private:
+  size_t size_{kMinSize};
+  // the previous read was small too
+  bool shrink_pending_{false};
+};
+
+} // namespace bamboo
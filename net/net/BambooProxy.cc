@@ -0,0 +1,498 @@
+#include "net/BambooProxy.h"
+
+#include "base/Logging.h"
+#include "controller/ClientSession.h"
+#include "controller/DatabaseManager.h"
+#include "net/TcpClient.h"
+
+#include <stdlib.h>
+
+namespace bamboo {
+
+namespace {
+const char kUnavailable[] = "ERROR: backend unavailable\r\n";
+const char kWrongArgs[] = "ERROR: wrong number of arguments\r\n";
+const char kOk[] = "OK\r\n";
+const char kEmpty[] = "EMPTY DATABASE\r\n";
+
+// commands the proxy serves, INFO, SLOWLOG and HOTKEYS are per backend
+const char kHelp[] =
+    "Available commands:\r\n"
+    "SELECT <index> - Select the database instance by index (0-9)\r\n"
+    "GET <key>      - Get the value associated with the key in the "
+    "current database\r\n"
+    "SET <key> <value> - Set the value for the key in the current "
+    "database\r\n"
+    "DEL <key>      - Delete the key from the current database\r\n"
+    "MGET <key> [key ...]          - Get values of keys, one per line\r\n"
+    "MSET <key> <value> [key value ...] - Set several keys at once\r\n"
+    "LIST           - List all key-value pairs in the current database\r\n"
+    "SAVE           - Dump all databases to the dump directory\r\n"
+    "BGSAVE         - Dump all databases in the background\r\n"
+    "CURRENTDB      - Show the current selected database index\r\n"
+    "HELP           - Show this help message\r\n";
+} // namespace
+
+struct BambooProxy::Request {
+  // how replies of backends become the response
+  enum Merge {
+    kFirst, // the only reply
+    kMget,  // values reordered as the keys
+    kAllOk, // OK if every backend says OK
+    kList,  // entries concatenated
+  };
+
+  Merge merge{kFirst};
+  std::weak_ptr<Session> session;
+  // one per backend call
+  std::vector<std::string> replies;
+  // kMget, key positions of reply lines
+  std::vector<std::vector<size_t>> positions;
+  size_t keys{0};
+  size_t outstanding{0};
+  bool done{false};
+  std::string response;
+};
+
+struct BambooProxy::Session {
+  int64_t id;
+  std::weak_ptr<TcpConnection> conn;
+  int db_index{0};
+  // answered in this order
+  std::deque<RequestPtr> requests;
+};
+
+struct BambooProxy::Backend {
+  struct Call {
+    RequestPtr request; // null for SELECT sent by the proxy
+    size_t slot;
+    ReplyKind kind;
+    size_t lines;
+  };
+
+  std::unique_ptr<TcpClient> client;
+  TcpConnectionPtr conn;
+  // database selected on the connection
+  int db_index{0};
+  // sent, waiting for replies
+  std::deque<Call> calls;
+  // queued, not written yet
+  std::string output;
+};
+
+BambooProxy::BambooProxy(EventLoop *loop, const InetAddress &listenAddr,
+                         const std::vector<InetAddress> &backendAddrs,
+                         int poolSize)
+    : loop_(loop), server_(loop, listenAddr, "BambooProxy"),
+      pool_size_(poolSize) {
+  server_.setConnectionCallback(
+      std::bind(&BambooProxy::onConnection, this, std::placeholders::_1));
+  server_.setMessageCallback(
+      std::bind(&BambooProxy::onMessage, this, std::placeholders::_1,
+                std::placeholders::_2, std::placeholders::_3));
+
+  for (const auto &addr : backendAddrs) {
+    ring_.addNode(addr.toIpPort());
+    for (int i = 0; i < pool_size_; ++i) {
+      std::unique_ptr<Backend> backend(new Backend);
+      backend->client.reset(
+          new TcpClient(loop, addr,
+                        "BambooProxy-" + addr.toIpPort() + "#" +
+                            std::to_string(i)));
+      backend->client->setConnectionCallback(
+          std::bind(&BambooProxy::onBackendConnection, this, backend.get(),
+                    std::placeholders::_1));
+      backend->client->setMessageCallback(
+          std::bind(&BambooProxy::onBackendMessage, this, backend.get(),
+                    std::placeholders::_1, std::placeholders::_2,
+                    std::placeholders::_3));
+      backend->client->enableRetry();
+      backends_.push_back(std::move(backend));
+    }
+  }
+}
+
+BambooProxy::~BambooProxy() = default;
+
+void BambooProxy::start() {
+  for (auto &backend : backends_) {
+    backend->client->connect();
+  }
+  server_.start();
+}
+
+void BambooProxy::onConnection(const TcpConnectionPtr &conn) {
+  LOG_INFO << "BambooProxy - " << conn->peerAddress().toIpPort() << " -> "
+           << conn->localAddress().toIpPort() << " is "
+           << (conn->connected() ? "UP" : "DOWN");
+
+  if (conn->connected()) {
+    auto session = std::make_shared<Session>();
+    session->id = next_session_id_++;
+    session->conn = conn;
+    sessions_[conn] = session;
+  } else {
+    // replies still in flight are dropped
+    sessions_.erase(conn);
+  }
+}
+
+void BambooProxy::onMessage(const TcpConnectionPtr &conn, Buffer *buf,
+                            TimeStamp time) {
+  auto it = sessions_.find(conn);
+  if (it == sessions_.end()) {
+    conn->send("ERROR: No session found\r\n");
+    return;
+  }
+  SessionPtr session = it->second;
+
+  const char *eol;
+  while ((eol = buf->findEOL()) != nullptr) {
+    std::string command(buf->peek(), eol);
+    buf->retrieveUntil(eol + 1);
+    if (!command.empty() && command.back() == '\r') {
+      command.pop_back();
+    }
+
+    size_t spacePos = command.find(' ');
+    if (spacePos != std::string::npos) {
+      dispatch(session, command.substr(0, spacePos),
+               command.substr(spacePos + 1));
+    } else {
+      dispatch(session, command, std::string());
+    }
+  }
+
+  flushBackends();
+  flush(session);
+}
+
+void BambooProxy::onBackendConnection(Backend *backend,
+                                      const TcpConnectionPtr &conn) {
+  LOG_INFO << "BambooProxy - backend " << conn->peerAddress().toIpPort()
+           << " is " << (conn->connected() ? "UP" : "DOWN");
+
+  if (conn->connected()) {
+    backend->conn = conn;
+    backend->db_index = 0;
+    conn->setTcpNoDelay(true);
+    return;
+  }
+
+  backend->conn.reset();
+  backend->output.clear();
+  std::vector<SessionPtr> ready;
+  while (!backend->calls.empty()) {
+    auto call = std::move(backend->calls.front());
+    backend->calls.pop_front();
+    if (call.request) {
+      auto session = onReply(call.request, call.slot, kUnavailable);
+      if (session) {
+        ready.push_back(session);
+      }
+    }
+  }
+  for (const auto &session : ready) {
+    flush(session);
+  }
+}
+
+void BambooProxy::onBackendMessage(Backend *backend,
+                                   const TcpConnectionPtr &conn, Buffer *buf,
+                                   TimeStamp time) {
+  std::vector<SessionPtr> ready;
+  while (!backend->calls.empty()) {
+    auto &call = backend->calls.front();
+    const char *end = replyEnd(buf, call.kind, call.lines);
+    if (end == nullptr) {
+      break;
+    }
+    if (call.request) {
+      auto session =
+          onReply(call.request, call.slot, std::string(buf->peek(), end));
+      if (session) {
+        ready.push_back(session);
+      }
+    }
+    buf->retrieveUntil(end);
+    backend->calls.pop_front();
+  }
+
+  if (backend->calls.empty() && buf->readableBytes() > 0) {
+    LOG_ERROR << "BambooProxy - unexpected reply from backend "
+              << conn->peerAddress().toIpPort();
+    buf->retrieveAll();
+  }
+  for (const auto &session : ready) {
+    flush(session);
+  }
+}
+
+void BambooProxy::dispatch(const SessionPtr &session, const std::string &cmd,
+                           const std::string &args) {
+  auto request = std::make_shared<Request>();
+  request->session = session;
+  session->requests.push_back(request);
+
+  if (cmd == "GET" || cmd == "DEL") {
+    request->replies.resize(1);
+    request->outstanding = 1;
+    forward(session, request, 0, ring_.nodeOf(args), cmd + " " + args, kLine,
+            1);
+  } else if (cmd == "SET") {
+    size_t endPos = args.find(' ');
+    if (endPos == std::string::npos) {
+      finish(request, kWrongArgs);
+      return;
+    }
+    request->replies.resize(1);
+    request->outstanding = 1;
+    forward(session, request, 0, ring_.nodeOf(args.data(), endPos),
+            cmd + " " + args, kLine, 1);
+  } else if (cmd == "MGET") {
+    auto keys = ClientSession::splitArgs(args);
+    if (keys.empty()) {
+      finish(request, kWrongArgs);
+      return;
+    }
+    // group keys by backend, remember where each value goes
+    std::vector<std::vector<size_t>> groups(ring_.nodeCount());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      groups[ring_.nodeOf(keys[i])].push_back(i);
+    }
+    request->merge = Request::kMget;
+    request->keys = keys.size();
+    for (auto &group : groups) {
+      if (!group.empty()) {
+        request->positions.push_back(std::move(group));
+      }
+    }
+    request->replies.resize(request->positions.size());
+    request->outstanding = request->positions.size();
+    for (size_t slot = 0; slot < request->positions.size(); ++slot) {
+      const auto &positions = request->positions[slot];
+      std::string command = "MGET";
+      for (size_t i : positions) {
+        command += " " + keys[i];
+      }
+      forward(session, request, slot, ring_.nodeOf(keys[positions[0]]),
+              command, kLines, positions.size());
+    }
+  } else if (cmd == "MSET") {
+    auto parts = ClientSession::splitArgs(args);
+    if (parts.empty() || parts.size() % 2 != 0) {
+      finish(request, kWrongArgs);
+      return;
+    }
+    std::vector<std::string> commands(ring_.nodeCount());
+    for (size_t i = 0; i < parts.size(); i += 2) {
+      auto &command = commands[ring_.nodeOf(parts[i])];
+      if (command.empty()) {
+        command = "MSET";
+      }
+      command += " " + parts[i] + " " + parts[i + 1];
+    }
+    request->merge = Request::kAllOk;
+    for (const auto &command : commands) {
+      if (!command.empty()) {
+        ++request->outstanding;
+      }
+    }
+    request->replies.resize(request->outstanding);
+    size_t slot = 0;
+    for (int node = 0; node < ring_.nodeCount(); ++node) {
+      if (!commands[node].empty()) {
+        forward(session, request, slot++, node, commands[node], kLine, 1);
+      }
+    }
+  } else if (cmd == "LIST" || cmd == "SAVE" || cmd == "BGSAVE") {
+    // every backend
+    request->merge = cmd == "LIST" ? Request::kList : Request::kAllOk;
+    request->replies.resize(ring_.nodeCount());
+    request->outstanding = ring_.nodeCount();
+    for (int node = 0; node < ring_.nodeCount(); ++node) {
+      forward(session, request, node, node, cmd,
+              cmd == "LIST" ? kList : kLine, 1);
+    }
+  } else if (cmd == "SELECT") {
+    // the proxy selects the database on backend connections when needed
+    char *end;
+    long index = ::strtol(args.c_str(), &end, 10);
+    if (args.empty() || *end != '\0' || index < 0 ||
+        index >= DatabaseManager::kNumDatabases) {
+      finish(request, "Invalid database index\r\n");
+      return;
+    }
+    session->db_index = static_cast<int>(index);
+    finish(request, kOk);
+  } else if (cmd == "CURRENTDB") {
+    finish(request, "Current Database Index: " +
+                        std::to_string(session->db_index) + "\r\n");
+  } else if (cmd == "HELP") {
+    finish(request, kHelp);
+  } else {
+    finish(request, "UNKNOWN COMMAND\r\n");
+  }
+}
+
+void BambooProxy::forward(const SessionPtr &session, const RequestPtr &request,
+                          size_t slot, int node, const std::string &command,
+                          ReplyKind kind, size_t lines) {
+  // a session always uses the same connection to a backend,
+  // so its commands are answered in order
+  auto backend =
+      backends_[node * pool_size_ + session->id % pool_size_].get();
+  if (!backend->conn) {
+    onReply(request, slot, kUnavailable);
+    return;
+  }
+
+  if (backend->output.empty()) {
+    pending_backends_.push_back(backend);
+  }
+  if (backend->db_index != session->db_index) {
+    backend->output += "SELECT " + std::to_string(session->db_index) + "\n";
+    backend->calls.push_back({nullptr, 0, kLine, 1});
+    backend->db_index = session->db_index;
+  }
+  backend->output += command;
+  backend->output += '\n';
+  backend->calls.push_back({request, slot, kind, lines});
+}
+
+BambooProxy::SessionPtr BambooProxy::onReply(const RequestPtr &request,
+                                             size_t slot,
+                                             const std::string &reply) {
+  request->replies[slot] = reply;
+  if (--request->outstanding > 0) {
+    return nullptr;
+  }
+  merge(request.get());
+  request->done = true;
+  return request->session.lock();
+}
+
+void BambooProxy::finish(const RequestPtr &request,
+                         const std::string &response) {
+  request->response = response;
+  request->done = true;
+}
+
+void BambooProxy::flush(const SessionPtr &session) {
+  std::string response;
+  while (!session->requests.empty() && session->requests.front()->done) {
+    response += session->requests.front()->response;
+    session->requests.pop_front();
+  }
+
+  auto conn = session->conn.lock();
+  if (conn && !response.empty()) {
+    conn->send(response);
+  }
+}
+
+void BambooProxy::flushBackends() {
+  for (auto backend : pending_backends_) {
+    if (backend->conn) {
+      backend->conn->send(backend->output);
+    }
+    backend->output.clear();
+  }
+  pending_backends_.clear();
+}
+
+const char *BambooProxy::replyEnd(const Buffer *buf, ReplyKind kind,
+                                  size_t lines) {
+  const char *start = buf->peek();
+  const char *eol;
+  switch (kind) {
+  case kLine:
+  case kLines:
+    for (size_t i = 0; i < lines; ++i) {
+      if ((eol = buf->findEOL(start)) == nullptr) {
+        return nullptr;
+      }
+      start = eol + 1;
+    }
+    return start;
+  case kList:
+    if ((eol = buf->findEOL(start)) == nullptr) {
+      return nullptr;
+    }
+    // "key: value" entries never match the one line of an empty database,
+    // the key has no space; LIST itself has no error reply, the connection
+    // closes after a protocol error and the call gets kUnavailable
+    if (std::string(start, eol + 1) == kEmpty) {
+      return eol + 1;
+    }
+    // entries end with a blank line
+    while (eol - start > 1 || (eol - start == 1 && *start != '\r')) {
+      start = eol + 1;
+      if ((eol = buf->findEOL(start)) == nullptr) {
+        return nullptr;
+      }
+    }
+    return eol + 1;
+  }
+  return nullptr;
+}
+
+void BambooProxy::merge(Request *request) {
+  auto &replies = request->replies;
+  switch (request->merge) {
+  case Request::kFirst:
+    request->response = std::move(replies[0]);
+    break;
+  case Request::kAllOk:
+    request->response = kOk;
+    for (const auto &reply : replies) {
+      if (reply != kOk) {
+        request->response = reply;
+        break;
+      }
+    }
+    break;
+  case Request::kMget: {
+    std::vector<std::string> values(request->keys);
+    for (size_t slot = 0; slot < replies.size(); ++slot) {
+      const auto &reply = replies[slot];
+      const auto &positions = request->positions[slot];
+      std::vector<std::string> lines;
+      size_t start = 0;
+      size_t eol;
+      while ((eol = reply.find('\n', start)) != std::string::npos) {
+        lines.emplace_back(reply, start, eol + 1 - start);
+        start = eol + 1;
+      }
+      for (size_t i = 0; i < positions.size(); ++i) {
+        // a backend answers with a line per key, the proxy with one
+        // kUnavailable for all keys of a backend it cannot reach
+        values[positions[i]] =
+            reply == kUnavailable ? reply : std::move(lines[i]);
+      }
+    }
+    request->response.clear();
+    for (const auto &value : values) {
+      request->response += value;
+    }
+    break;
+  }
+  case Request::kList: {
+    std::string entries;
+    for (const auto &reply : replies) {
+      if (reply == kUnavailable) {
+        request->response = reply;
+        return;
+      }
+      if (reply != kEmpty) {
+        // drop the blank line at the end
+        entries.append(reply, 0, reply.size() - 2);
+      }
+    }
+    request->response = entries.empty() ? kEmpty : entries + "\r\n";
+    break;
+  }
+  }
+}
+
+} // namespace bamboo
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "base/Macro.h"
+#include "net/ConsistentHash.h"
+#include "net/TcpServer.h"
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace bamboo {
+
+class TcpClient;
+
+// sharding proxy in front of several bamboo servers
+// keys are mapped to backends with consistent hashing, commands to a backend
+// are pipelined over a small pool of connections; MGET/MSET are split by
+// backend and LIST/SAVE/BGSAVE are sent to every backend, replies are merged
+// not thread safe, runs in a single loop
+class BambooProxy {
+public:
+  BambooProxy(EventLoop *loop, const InetAddress &listenAddr,
+              const std::vector<InetAddress> &backendAddrs, int poolSize = 2);
+
+  DISALLOW_COPY(BambooProxy)
+
+  ~BambooProxy();
+
+  void start();
+
+private:
+  struct Request;
+  struct Session;
+  struct Backend;
+  using RequestPtr = std::shared_ptr<Request>;
+  using SessionPtr = std::shared_ptr<Session>;
+
+  // shape of a backend reply
+  enum ReplyKind {
+    kLine,  // one line
+    kLines, // fixed number of lines
+    kList,  // LIST reply, ends with a blank line
+  };
+
+  void onConnection(const TcpConnectionPtr &conn);
+
+  void onMessage(const TcpConnectionPtr &conn, Buffer *buf, TimeStamp time);
+
+  void onBackendConnection(Backend *backend, const TcpConnectionPtr &conn);
+
+  void onBackendMessage(Backend *backend, const TcpConnectionPtr &conn,
+                        Buffer *buf, TimeStamp time);
+
+  void dispatch(const SessionPtr &session, const std::string &cmd,
+                const std::string &args);
+
+  // queue command on the pooled connection of the session to node
+  void forward(const SessionPtr &session, const RequestPtr &request,
+               size_t slot, int node, const std::string &command,
+               ReplyKind kind, size_t lines);
+
+  // return session of request if all replies have arrived
+  SessionPtr onReply(const RequestPtr &request, size_t slot,
+                     const std::string &reply);
+
+  // answer request without asking any backend
+  void finish(const RequestPtr &request, const std::string &response);
+
+  // end of the reply in buf, nullptr if incomplete
+  static const char *replyEnd(const Buffer *buf, ReplyKind kind, size_t lines);
+
+  static void merge(Request *request);
+
+  // send responses that are ready, in the order of requests
+  void flush(const SessionPtr &session);
+
+  // write commands queued by forward()
+  void flushBackends();
+
+  EventLoop *loop_;
+  TcpServer server_;
+  ConsistentHash ring_;
+  const int pool_size_;
+  // backends_[node * pool_size_ + i] is the i-th connection to node
+  std::vector<std::unique_ptr<Backend>> backends_;
+  // backends with commands not written yet
+  std::vector<Backend *> pending_backends_;
+
+  int64_t next_session_id_{0};
+  std::unordered_map<TcpConnectionPtr, SessionPtr> sessions_;
+};
+
+} // namespace bamboo
@@ -1,33 +1,119 @@
 #include "net/BambooServer.h"
 
+#include "base/AsyncLogging.h"
+#include "base/Histogram.h"
 #include "base/Logging.h"
 #include "controller/ClientSession.h"
 #include "controller/DatabaseManager.h"
+#include "controller/HotKeys.h"
+#include "controller/Replication.h"
+#include "net/ReplicaClient.h"
+#include "net/ReplicationSource.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThreadPool.h"
+#include "net/MetricsServer.h"
 #include "net/TcpConnection.h"
 
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
 namespace bamboo {
 
-BambooServer::BambooServer(EventLoop *loop, const InetAddress &listenAddr)
-    : server_(loop, listenAddr, "BambooServer"),
-      db_manager_(new DatabaseManager()) {
+BambooServer::BambooServer(EventLoop *loop, const InetAddress &listenAddr,
+                           const std::string &dataDir)
+    : loop_(loop), db_manager_(new DatabaseManager(dataDir)),
+      hot_keys_(new HotKeys(DatabaseManager::kNumDatabases)),
+      replication_(new ReplicationSource(loop, db_manager_.get())),
+      server_(loop, listenAddr, "BambooServer") {
   server_.setConnectionCallback(
       std::bind(&BambooServer::onConnection, this, std::placeholders::_1));
   server_.setMessageCallback(
       std::bind(&BambooServer::onMessage, this, std::placeholders::_1,
                 std::placeholders::_2, std::placeholders::_3));
+  server_.setInputLimitCallback([](const TcpConnectionPtr &conn, size_t) {
+    conn->send("ERROR: request too large\r\n");
+  });
 }
 
 BambooServer::~BambooServer() = default;
 
+void BambooServer::start() {
+  if (replica_) {
+    replica_->connect();
+  }
+  server_.start();
+  if (metrics_server_) {
+    metrics_server_->start();
+    // the loop time totals are scraped, time every iteration
+    for (auto loop : server_.threadPool()->getAllLoops()) {
+      loop->runInLoop([loop]() { loop->setIterationTiming(true); });
+    }
+  }
+  if (slow_iteration_budget_ > 0) {
+    int64_t budget = slow_iteration_budget_;
+    for (auto loop : server_.threadPool()->getAllLoops()) {
+      loop->runInLoop([loop, budget]() {
+        loop->setSlowIterationCallback(budget, [](const IterationInfo &info) {
+          LOG_WARN << "slow event loop iteration " << info.iteration << ": "
+                   << info.events << " events in " << info.handle_event_time
+                   << "us, " << info.functors << " functors in "
+                   << info.pending_functors_time << "us";
+        });
+      });
+    }
+  }
+  if (busy_poll_micros_ > 0) {
+    int64_t micros = busy_poll_micros_;
+    for (auto loop : server_.threadPool()->getAllLoops()) {
+      loop->runInLoop([loop, micros]() { loop->setBusyPoll(micros); });
+    }
+  }
+  if (functor_budget_count_ > 0 || functor_budget_micros_ > 0) {
+    size_t count = functor_budget_count_;
+    int64_t micros = functor_budget_micros_;
+    for (auto loop : server_.threadPool()->getAllLoops()) {
+      loop->runInLoop(
+          [loop, count, micros]() { loop->setFunctorBudget(count, micros); });
+    }
+  }
+  loop_->runEvery(ServerStats::kSampleInterval, [this]() { stats_.sample(); });
+}
+
+void BambooServer::setDumpDirectory(const std::string &dir) {
+  db_manager_->setDumpDirectory(dir);
+}
+
+void BambooServer::loadDumps() { db_manager_->loadDumps(); }
+
+void BambooServer::setReplicaOf(const InetAddress &primaryAddr) {
+  LOG_INFO << "BambooServer - replica of " << primaryAddr.toIpPort();
+  replica_.reset(new ReplicaClient(loop_, primaryAddr, db_manager_.get()));
+}
+
+void BambooServer::setMetricsAddress(const InetAddress &addr) {
+  LOG_INFO << "BambooServer - metrics at http://" << addr.toIpPort()
+           << "/metrics";
+  metrics_server_.reset(
+      new MetricsServer(loop_, addr, [this]() { return metrics(); }));
+}
+
 void BambooServer::onConnection(const TcpConnectionPtr &conn) {
   LOG_INFO << "KVServer - " << conn->peerAddress().toIpPort() << " -> "
            << conn->localAddress().toIpPort() << " is "
            << (conn->connected() ? "UP" : "DOWN");
 
+  stats_.onConnection(conn->connected());
   if (conn->connected()) {
-    sessions_[conn] = std::make_shared<ClientSession>(db_manager_.get());
+    auto session = std::make_shared<ClientSession>(db_manager_.get());
+    session->setReadOnly(replica_ != nullptr);
+    session->setHotKeys(hot_keys_.get());
+    sessions_[conn] = session;
   } else {
     sessions_.erase(conn);
+    replication_->removeReplica(conn);
   }
 }
 
@@ -39,24 +125,478 @@ void BambooServer::onMessage(const TcpConnectionPtr &conn, Buffer *buf,
     return;
   }
 
-  std::string msg(buf->retrieveAllString());
-  size_t pos = msg.find('\n');
-  if (pos == std::string::npos) {
-    return;
+  size_t readable = buf->readableBytes();
+
+  // pipelined commands are answered with a single send, large replies are
+  // sent early and a backpressured connection keeps the rest of its input
+  // until it drains
+  std::string response;
+  std::vector<Command> commands;
+  // a command starts where the previous one ended, one clock read each
+  TimeStamp start;
+  auto flush = [&]() {
+    if (response.empty()) {
+      return;
+    }
+    int64_t latency =
+        start.microSecondsSinceEpoch() - time.microSecondsSinceEpoch();
+    for (auto type : commands) {
+      stats_.recordLatency(type, latency);
+    }
+    commands.clear();
+    stats_.addBytesOut(response.size());
+    conn->send(response);
+    response.clear();
+  };
+  const char *eol;
+  while ((eol = buf->findEOL()) != nullptr) {
+    std::string command(buf->peek(), eol);
+    buf->retrieveUntil(eol + 1);
+    if (!command.empty() && command.back() == '\r') {
+      command.pop_back();
+    }
+
+    size_t spacePos = command.find(' ');
+    std::string cmd;
+    std::string args;
+    if (spacePos != std::string::npos) {
+      cmd = command.substr(0, spacePos);
+      args = command.substr(spacePos + 1);
+    } else {
+      cmd = command;
+    }
+
+    if (cmd == replication::kSyncCommand) {
+      // the connection only carries the replication stream from now on
+      buf->retrieveAll();
+      replication_->addReplica(conn);
+      break;
+    }
+
+    Command type = commandOf(cmd);
+    stats_.onCommand(type);
+    commands.push_back(type);
+    int db_index = session->second->getCurrentDbIndex();
+    if (!start.isValid()) {
+      start = TimeStamp::now();
+    }
+    if (type == kCmdInfo) {
+      response += info(args);
+    } else if (type == kCmdSlowlog) {
+      response += slowlogCommand(args);
+    } else {
+      response += session->second->processCommand(cmd, args);
+    }
+    TimeStamp end = TimeStamp::now();
+    int64_t duration =
+        end.microSecondsSinceEpoch() - start.microSecondsSinceEpoch();
+    if (slowlog_.slow(duration)) {
+      slowlog_.add(start.microSecondsSinceEpoch(), duration, db_index, command,
+                   conn->peerAddress().toIpPort());
+    }
+    start = end;
+    if (response.size() >= kReplyFlushBytes) {
+      flush();
+      if (conn->backpressured()) {
+        break;
+      }
+    }
   }
-  std::string command = msg.substr(0, pos);
+  flush();
+  stats_.addBytesIn(readable - buf->readableBytes());
+}
 
-  size_t spacePos = command.find(' ');
-  std::string cmd;
-  std::string args;
-  if (spacePos != std::string::npos) {
-    cmd = command.substr(0, spacePos);
-    args = command.substr(spacePos + 1);
-  } else {
-    cmd = command;
+namespace {
+// multi-line value, each line indented, empty lines dropped
+void appendIndented(std::string *out, const std::string &text) {
+  size_t start = 0;
+  while (start < text.size()) {
+    size_t end = text.find('\n', start);
+    if (end == std::string::npos) {
+      end = text.size();
+    }
+    if (end > start) {
+      *out += "  ";
+      out->append(text, start, end - start);
+      *out += "\r\n";
+    }
+    start = end + 1;
+  }
+}
+} // namespace
+
+std::string BambooServer::slowlogCommand(const std::string &args) {
+  auto parts = ClientSession::splitArgs(args);
+  std::string sub = parts.empty() ? std::string() : parts[0];
+  for (auto &c : sub) {
+    c = static_cast<char>(::toupper(c));
   }
 
-  std::string response = session->second->processCommand(cmd, args);
-  conn->send(response);
+  if (sub == "GET" && parts.size() <= 2) {
+    size_t count = 10;
+    if (parts.size() == 2) {
+      char *end;
+      long n = ::strtol(parts[1].c_str(), &end, 10);
+      if (*end != '\0' || n < 0) {
+        return "ERROR: invalid count\r\n";
+      }
+      count = static_cast<size_t>(n);
+    }
+    // one entry per line, newest first, ends with a blank line
+    std::string out;
+    for (const auto &entry : slowlog_.get(count)) {
+      out += "id=" + std::to_string(entry.id) +
+             " time=" + std::to_string(entry.start_time /
+                                       TimeStamp::kMicroSecondsPerSecond) +
+             " duration=" + std::to_string(entry.duration) +
+             " db=" + std::to_string(entry.db_index) + " client=" +
+             entry.client + " command=" + entry.command + "\r\n";
+    }
+    return out + "\r\n";
+  } else if (sub == "LEN" && parts.size() == 1) {
+    return std::to_string(slowlog_.size()) + "\r\n";
+  } else if (sub == "RESET" && parts.size() == 1) {
+    slowlog_.reset();
+    return "OK\r\n";
+  }
+  return "ERROR: usage SLOWLOG GET [count] | LEN | RESET\r\n";
 }
-} // namespace bamboo
\ No newline at end of file
+
+std::string BambooServer::info(const std::string &section) {
+  std::string name;
+  for (char c : section) {
+    name.push_back(static_cast<char>(::tolower(c)));
+  }
+  auto wanted = [&name](const char *s) {
+    return name.empty() || name == "all" || name == s;
+  };
+
+  std::string out;
+  if (wanted("server")) {
+    out += "# Server\r\n";
+    out += "role:" + std::string(replica_ ? "replica" : "primary") + "\r\n";
+    out += "tcp_address:" + server_.ipPort() + "\r\n";
+    out += "uptime_in_seconds:" + std::to_string(stats_.uptimeSeconds()) +
+           "\r\n";
+  }
+  if (wanted("clients")) {
+    out += "# Clients\r\n";
+    out += "connected_clients:" + std::to_string(stats_.connectedClients()) +
+           "\r\n";
+    out += "total_connections_received:" +
+           std::to_string(stats_.totalConnections()) + "\r\n";
+    out += "idle_connections_closed:" + std::to_string(server_.idleClosed()) +
+           "\r\n";
+    out += "input_buffer_bytes:" + std::to_string(server_.inputBytes()) +
+           "\r\n";
+    out += "connected_replicas:" +
+           std::to_string(replication_->replicaCount()) + "\r\n";
+    out += "replica_backlog_overflows:" +
+           std::to_string(replication_->backlogOverflows()) + "\r\n";
+  }
+  if (wanted("stats")) {
+    uint64_t hits = db_manager_->keyspaceHits();
+    uint64_t misses = db_manager_->keyspaceMisses();
+    char rate[32];
+    ::snprintf(rate, sizeof rate, "%.4f",
+               hits + misses > 0 ? static_cast<double>(hits) / (hits + misses)
+                                 : 0.0);
+    out += "# Stats\r\n";
+    out += "total_commands_processed:" + std::to_string(stats_.totalCalls()) +
+           "\r\n";
+    out += "total_net_input_bytes:" + std::to_string(stats_.bytesIn()) + "\r\n";
+    out += "total_net_output_bytes:" + std::to_string(stats_.bytesOut()) +
+           "\r\n";
+    out += "keyspace_hits:" + std::to_string(hits) + "\r\n";
+    out += "keyspace_misses:" + std::to_string(misses) + "\r\n";
+    out += "cache_hit_rate:" + std::string(rate) + "\r\n";
+  }
+  if (wanted("commands")) {
+    out += "# Commands\r\n";
+    for (int i = 0; i < kNumCommands; ++i) {
+      auto command = static_cast<Command>(i);
+      if (stats_.calls(command) > 0) {
+        out += "cmdstat_" + std::string(commandName(command)) +
+               ":calls=" + std::to_string(stats_.calls(command)) +
+               ",ops_per_sec=" + std::to_string(stats_.opsPerSecond(command)) +
+               "\r\n";
+      }
+    }
+  }
+  if (wanted("latency")) {
+    // microseconds
+    out += "# Latency\r\n";
+    for (int i = 0; i < kNumCommands; ++i) {
+      auto command = static_cast<Command>(i);
+      auto h = stats_.latency(command);
+      if (h.count() > 0) {
+        out += "latency_" + std::string(commandName(command)) +
+               ":count=" + std::to_string(h.count()) +
+               ",mean=" + std::to_string(static_cast<uint64_t>(h.mean())) +
+               ",p50=" + std::to_string(h.percentile(50)) +
+               ",p99=" + std::to_string(h.percentile(99)) +
+               ",p999=" + std::to_string(h.percentile(99.9)) +
+               ",max=" + std::to_string(h.max()) + "\r\n";
+      }
+    }
+  }
+  if (wanted("loops")) {
+    out += "# Loops\r\n";
+    auto loops = server_.threadPool()->getAllLoops();
+    for (size_t i = 0; i < loops.size(); ++i) {
+      const auto &loop_stats = loops[i]->stats();
+      char events_per_poll[32];
+      ::snprintf(events_per_poll, sizeof events_per_poll, "%.2f",
+                 loop_stats.eventsPerPoll());
+      out += "loop" + std::to_string(i) +
+             ":iterations=" + std::to_string(loop_stats.iterations()) +
+             ",events_per_poll=" + events_per_poll +
+             ",max_events_per_poll=" +
+             std::to_string(loop_stats.maxEventsPerPoll()) +
+             ",handle_event_us=" +
+             std::to_string(loop_stats.handleEventTime()) +
+             ",pending_functors_us=" +
+             std::to_string(loop_stats.pendingFunctorsTime()) +
+             ",functors=" + std::to_string(loop_stats.functors()) +
+             ",queue_depth=" + std::to_string(loops[i]->queueSize()) +
+             ",wakeups=" + std::to_string(loop_stats.wakeups()) +
+             ",timer_fires=" + std::to_string(loop_stats.timerFires()) +
+             ",slow_iterations=" +
+             std::to_string(loop_stats.slowIterations()) +
+             ",empty_spins=" + std::to_string(loop_stats.emptySpins()) +
+             ",functor_budget_exhausted=" +
+             std::to_string(loop_stats.functorBudgetExhausted()) + "\r\n";
+    }
+  }
+  if (wanted("storage")) {
+    out += "# Storage\r\n";
+    for (int i = 0; i < DatabaseManager::kNumDatabases; ++i) {
+      auto prefix = "db" + std::to_string(i);
+      out += prefix + "_approximate_memory_usage:" +
+             db_manager_->property(i, "leveldb.approximate-memory-usage") +
+             "\r\n";
+      out += prefix + "_stats:\r\n";
+      appendIndented(&out, db_manager_->property(i, "leveldb.stats"));
+      out += prefix + "_sstables:\r\n";
+      appendIndented(&out, db_manager_->property(i, "leveldb.sstables"));
+    }
+  }
+  // ends with a blank line, like LIST
+  out += "\r\n";
+  return out;
+}
+namespace {
+void appendMetric(std::string *out, const char *name, const char *type,
+                  const char *help) {
+  *out += "# HELP ";
+  *out += name;
+  *out += ' ';
+  *out += help;
+  *out += "\n# TYPE ";
+  *out += name;
+  *out += ' ';
+  *out += type;
+  *out += '\n';
+}
+
+void appendSample(std::string *out, const std::string &name,
+                  const std::string &labels, uint64_t value) {
+  *out += name;
+  if (!labels.empty()) {
+    *out += "{" + labels + "}";
+  }
+  *out += " " + std::to_string(value) + "\n";
+}
+
+void appendSample(std::string *out, const std::string &name,
+                  const std::string &labels, double value) {
+  char buf[32];
+  ::snprintf(buf, sizeof buf, "%.9g", value);
+  *out += name;
+  if (!labels.empty()) {
+    *out += "{" + labels + "}";
+  }
+  *out += " ";
+  *out += buf;
+  *out += "\n";
+}
+
+// upper bounds of exported latency buckets, in microseconds
+const uint64_t kLatencyBuckets[] = {
+    100,    250,    500,     1000,    2500,    5000,    10000,   25000,
+    50000,  100000, 250000,  500000,  1000000, 2500000, 5000000, 10000000,
+};
+} // namespace
+
+std::string BambooServer::metrics() {
+  std::string out;
+  appendMetric(&out, "bamboo_uptime_seconds", "gauge",
+               "Seconds since the server started.");
+  appendSample(&out, "bamboo_uptime_seconds", "",
+               static_cast<uint64_t>(stats_.uptimeSeconds()));
+
+  appendMetric(&out, "bamboo_connected_clients", "gauge",
+               "Client connections currently open.");
+  appendSample(&out, "bamboo_connected_clients", "",
+               static_cast<uint64_t>(stats_.connectedClients()));
+  appendMetric(&out, "bamboo_connections_received_total", "counter",
+               "Client connections accepted.");
+  appendSample(&out, "bamboo_connections_received_total", "",
+               stats_.totalConnections());
+  appendMetric(&out, "bamboo_idle_connections_closed_total", "counter",
+               "Client connections closed by the idle timeout.");
+  appendSample(&out, "bamboo_idle_connections_closed_total", "",
+               server_.idleClosed());
+  appendMetric(&out, "bamboo_input_buffer_bytes", "gauge",
+               "Memory of client input buffers, with a total input limit.");
+  appendSample(&out, "bamboo_input_buffer_bytes", "",
+               static_cast<uint64_t>(server_.inputBytes()));
+  appendMetric(&out, "bamboo_connected_replicas", "gauge",
+               "Replicas streaming from this server.");
+  appendSample(&out, "bamboo_connected_replicas", "",
+               static_cast<uint64_t>(replication_->replicaCount()));
+  appendMetric(&out, "bamboo_replica_backlog_overflows_total", "counter",
+               "Replicas dropped for their backlog during full sync.");
+  appendSample(&out, "bamboo_replica_backlog_overflows_total", "",
+               replication_->backlogOverflows());
+
+  appendMetric(&out, "bamboo_net_input_bytes_total", "counter",
+               "Bytes read from clients.");
+  appendSample(&out, "bamboo_net_input_bytes_total", "", stats_.bytesIn());
+  appendMetric(&out, "bamboo_net_output_bytes_total", "counter",
+               "Bytes sent to clients.");
+  appendSample(&out, "bamboo_net_output_bytes_total", "", stats_.bytesOut());
+
+  appendMetric(&out, "bamboo_commands_total", "counter",
+               "Commands processed.");
+  for (int i = 0; i < kNumCommands; ++i) {
+    auto command = static_cast<Command>(i);
+    appendSample(&out, "bamboo_commands_total",
+                 "command=\"" + std::string(commandName(command)) + "\"",
+                 stats_.calls(command));
+  }
+
+  appendMetric(&out, "bamboo_command_latency_seconds", "histogram",
+               "Time from receiving a command to sending its response.");
+  for (int i = 0; i < kNumCommands; ++i) {
+    auto command = static_cast<Command>(i);
+    auto h = stats_.latency(command);
+    if (h.count() == 0) {
+      continue;
+    }
+    std::string label =
+        "command=\"" + std::string(commandName(command)) + "\"";
+    char le[32];
+    uint64_t last_edge = 0;
+    for (uint64_t bound : kLatencyBuckets) {
+      // the upper edge of the bucket holding bound, so le is exact rather
+      // than a bound inside a bucket whose values are all counted
+      uint64_t edge = Histogram::upperBound(Histogram::bucketOf(bound));
+      if (edge == last_edge) {
+        continue;
+      }
+      last_edge = edge;
+      ::snprintf(le, sizeof le, "%.9g",
+                 static_cast<double>(edge) /
+                     TimeStamp::kMicroSecondsPerSecond);
+      appendSample(&out, "bamboo_command_latency_seconds_bucket",
+                   label + ",le=\"" + le + "\"", h.countAtOrBelow(edge));
+    }
+    appendSample(&out, "bamboo_command_latency_seconds_bucket",
+                 label + ",le=\"+Inf\"", h.count());
+    appendSample(&out, "bamboo_command_latency_seconds_sum", label,
+                 static_cast<double>(h.sum()) /
+                     TimeStamp::kMicroSecondsPerSecond);
+    appendSample(&out, "bamboo_command_latency_seconds_count", label,
+                 h.count());
+  }
+
+  struct LoopCounter {
+    const char *name;
+    const char *help;
+    uint64_t (EventLoopStats::*value)() const;
+  };
+  static const LoopCounter kLoopCounters[] = {
+      {"bamboo_loop_iterations_total", "Event loop iterations.",
+       &EventLoopStats::iterations},
+      {"bamboo_loop_events_total", "Channels returned by poll.",
+       &EventLoopStats::events},
+      {"bamboo_loop_handle_event_microseconds_total",
+       "Time spent in Channel::handleEvent.", &EventLoopStats::handleEventTime},
+      {"bamboo_loop_pending_functors_microseconds_total",
+       "Time spent running queued functors.",
+       &EventLoopStats::pendingFunctorsTime},
+      {"bamboo_loop_functors_total", "Queued functors run.",
+       &EventLoopStats::functors},
+      {"bamboo_loop_wakeups_total", "Writes to the wakeup eventfd.",
+       &EventLoopStats::wakeups},
+      {"bamboo_loop_timer_fires_total", "Timers expired.",
+       &EventLoopStats::timerFires},
+      {"bamboo_loop_slow_iterations_total", "Iterations over the budget.",
+       &EventLoopStats::slowIterations},
+      {"bamboo_loop_empty_spins_total", "Busy polls that found nothing.",
+       &EventLoopStats::emptySpins},
+      {"bamboo_loop_functor_budget_exhausted_total",
+       "Iterations that left queued functors for the next one.",
+       &EventLoopStats::functorBudgetExhausted},
+  };
+  auto loops = server_.threadPool()->getAllLoops();
+  for (const auto &counter : kLoopCounters) {
+    appendMetric(&out, counter.name, "counter", counter.help);
+    for (size_t i = 0; i < loops.size(); ++i) {
+      appendSample(&out, counter.name, "loop=\"" + std::to_string(i) + "\"",
+                   (loops[i]->stats().*counter.value)());
+    }
+  }
+  appendMetric(&out, "bamboo_loop_queue_depth", "gauge",
+               "Functors queued to the event loop.");
+  for (size_t i = 0; i < loops.size(); ++i) {
+    appendSample(&out, "bamboo_loop_queue_depth",
+                 "loop=\"" + std::to_string(i) + "\"",
+                 static_cast<uint64_t>(loops[i]->queueSize()));
+  }
+
+  appendMetric(&out, "bamboo_log_dropped_buffers_total", "counter",
+               "Async log buffers dropped because the writer fell behind.");
+  appendSample(&out, "bamboo_log_dropped_buffers_total", "",
+               async_logging_ ? async_logging_->droppedBuffers() : 0);
+  appendMetric(&out, "bamboo_log_dropped_bytes_total", "counter",
+               "Bytes of dropped async log buffers.");
+  appendSample(&out, "bamboo_log_dropped_bytes_total", "",
+               async_logging_ ? async_logging_->droppedBytes() : 0);
+
+  appendMetric(&out, "bamboo_keyspace_hits_total", "counter",
+               "GET of existing keys.");
+  appendSample(&out, "bamboo_keyspace_hits_total", "",
+               db_manager_->keyspaceHits());
+  appendMetric(&out, "bamboo_keyspace_misses_total", "counter",
+               "GET of missing keys.");
+  appendSample(&out, "bamboo_keyspace_misses_total", "",
+               db_manager_->keyspaceMisses());
+
+  appendMetric(&out, "bamboo_storage_memory_bytes", "gauge",
+               "LevelDB approximate memory usage.");
+  for (int i = 0; i < DatabaseManager::kNumDatabases; ++i) {
+    auto usage =
+        db_manager_->property(i, "leveldb.approximate-memory-usage");
+    appendSample(&out, "bamboo_storage_memory_bytes",
+                 "db=\"" + std::to_string(i) + "\"",
+                 static_cast<uint64_t>(::strtoull(usage.c_str(), nullptr, 10)));
+  }
+  appendMetric(&out, "bamboo_storage_files", "gauge",
+               "LevelDB table files per level.");
+  for (int i = 0; i < DatabaseManager::kNumDatabases; ++i) {
+    for (int level = 0; level < 7; ++level) {
+      auto files = db_manager_->property(
+          i, "leveldb.num-files-at-level" + std::to_string(level));
+      appendSample(&out, "bamboo_storage_files",
+                   "db=\"" + std::to_string(i) + "\",level=\"" +
+                       std::to_string(level) + "\"",
+                   static_cast<uint64_t>(
+                       ::strtoull(files.c_str(), nullptr, 10)));
+    }
+  }
+  return out;
+}
+
+} // namespace bamboo
@@ -1,29 +1,124 @@
 #pragma once
 
+#include "controller/ServerStats.h"
+#include "controller/SlowLog.h"
 #include "net/TcpServer.h"
 
 namespace bamboo {
 
+class AsyncLogging;
 class ClientSession;
 class DatabaseManager;
+class HotKeys;
+class MetricsServer;
+class ReplicaClient;
+class ReplicationSource;
 
 class BambooServer {
 public:
-  BambooServer(EventLoop *loop, const InetAddress &listenAddr);
+  // databases live under dataDir
+  BambooServer(EventLoop *loop, const InetAddress &listenAddr,
+               const std::string &dataDir = "dbinstance");
 
   ~BambooServer();
 
-  void start() { server_.start(); }
+  void start();
+
+  // directory that SAVE/BGSAVE write dumps to
+  void setDumpDirectory(const std::string &dir);
+
+  // restore databases from dump directory, call before start()
+  void loadDumps();
+
+  // run as a read-only replica of primary, call before start()
+  void setReplicaOf(const InetAddress &primaryAddr);
+
+  // serve Prometheus metrics at http://addr/metrics, call before start()
+  void setMetricsAddress(const InetAddress &addr);
+
+  // report drops of the async logger in metrics
+  void setAsyncLogging(const AsyncLogging *logging) {
+    async_logging_ = logging;
+  }
+
+  // edge triggered client connections, see TcpServer::setEdgeTriggered()
+  void setEdgeTriggered(bool on) { server_.setEdgeTriggered(on); }
+
+  // stop reading clients with more than high bytes of unsent replies
+  // until they drain to low, call before start()
+  void setBackpressure(size_t high, size_t low) {
+    server_.setBackpressure(high, low);
+  }
+
+  // clients get an error and are shut down when a request grows past
+  // perConnection bytes or the input of all clients past total bytes,
+  // 0 disables, call before start()
+  void setInputLimits(size_t perConnection, size_t total) {
+    server_.setInputLimits(perConnection, total);
+  }
+
+  // close clients that send nothing for seconds, call before start()
+  void setIdleTimeout(int seconds) { server_.setIdleTimeout(seconds); }
+
+  // loops spin for micros after the last event before blocking, and
+  // accepted sockets get SO_BUSY_POLL of socketMicros if positive,
+  // call before start()
+  void setBusyPoll(int64_t micros, int socketMicros) {
+    busy_poll_micros_ = micros;
+    server_.setSocketBusyPoll(socketMicros);
+  }
+
+  // per iteration budget of queued functors, see
+  // EventLoop::setFunctorBudget(), call before start()
+  void setFunctorBudget(size_t count, int64_t micros) {
+    functor_budget_count_ = count;
+    functor_budget_micros_ = micros;
+  }
+
+  // log event loop iterations slower than micros, call before start()
+  void setSlowIterationBudget(int64_t micros) {
+    slow_iteration_budget_ = micros;
+  }
+
+  const ServerStats &stats() const { return stats_; }
+
+  // commands running longer are logged, negative disables SLOWLOG
+  void setSlowlogThreshold(int64_t micros) { slowlog_.setThreshold(micros); }
+
+  // reply of INFO, all sections if section is empty
+  std::string info(const std::string &section);
+
+  // Prometheus text format
+  std::string metrics();
 
 private:
+  // replies of pipelined commands are sent once they reach this size
+  static constexpr size_t kReplyFlushBytes = 1024 * 1024;
+
   void onConnection(const TcpConnectionPtr &conn);
 
   void onMessage(const TcpConnectionPtr &conn, Buffer *buf, TimeStamp time);
 
-  TcpServer server_;
+  std::string slowlogCommand(const std::string &args);
+
+  EventLoop *loop_;
   std::unique_ptr<DatabaseManager> db_manager_;
+  std::unique_ptr<HotKeys> hot_keys_;
+  std::unique_ptr<ReplicationSource> replication_;
+  // not null in replica mode
+  std::unique_ptr<ReplicaClient> replica_;
   std::unordered_map<TcpConnectionPtr, std::shared_ptr<ClientSession>>
       sessions_;
+  std::unique_ptr<MetricsServer> metrics_server_;
+  const AsyncLogging *async_logging_{nullptr};
+  int64_t slow_iteration_budget_{0};
+  int64_t busy_poll_micros_{0};
+  size_t functor_budget_count_{0};
+  int64_t functor_budget_micros_{0};
+  ServerStats stats_;
+  SlowLog slowlog_;
+  // destroyed first, the connections it closes still find their sessions
+  TcpServer server_;
 };
 
 } // namespace bamboo
\ No newline at end of file
@@ -1,31 +1,73 @@
 #include "net/Buffer.h"
 
 #include "assert.h"
+#include <errno.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
+namespace {
+// overflow of readFd, shared by the buffers of the thread's loop; readv
+// only fills it, so it is never cleared
+thread_local char t_read_scratch[65536];
+} // namespace
+
 namespace bamboo {
 
-const char Buffer::kCRLF[] = "\r\n";
+constexpr size_t Buffer::kCheapPrepend;
+constexpr size_t Buffer::kInitialSize;
+
+char Buffer::kNoStorage[kCheapPrepend];
 
 Buffer::Buffer(size_t initial_size)
     : reader_index_(kCheapPrepend), writer_index_(kCheapPrepend),
-      buffer_(kCheapPrepend + initial_size) {
+      storage_(kNoStorage), capacity_(kCheapPrepend) {
+  if (initial_size > 0) {
+    reallocate(kCheapPrepend + initial_size, false);
+  }
   assert(readableBytes() == 0);
   assert(writeableBytes() == initial_size);
   assert(prependableBytes() == kCheapPrepend);
 }
 
+void Buffer::reallocate(size_t capacity, bool pooled) {
+  size_t readable = readableBytes();
+  assert(capacity >= kCheapPrepend + readable);
+  BufferChunk *chunk = nullptr;
+  char *storage = nullptr;
+  if (pooled && capacity <= BufferChunk::kSize) {
+    chunk = ChunkPool::get();
+    storage = chunk->data;
+    capacity = BufferChunk::kSize;
+  } else {
+    storage = new char[capacity];
+  }
+  memcpy(storage + kCheapPrepend, peek(), readable);
+  freeStorage();
+  storage_ = storage;
+  capacity_ = capacity;
+  chunk_ = chunk;
+  reader_index_ = kCheapPrepend;
+  writer_index_ = kCheapPrepend + readable;
+}
+
+void Buffer::freeStorage() {
+  if (chunk_ != nullptr) {
+    ChunkPool::put(chunk_);
+    chunk_ = nullptr;
+  } else if (storage_ != kNoStorage) {
+    delete[] storage_;
+  }
+}
+
 ssize_t Buffer::readFd(int fd, int *saveErrno) {
-  char extrabuf[65536] = {0};
-  struct iovec vec[2];
   const auto writable_bytes = writeableBytes();
+  struct iovec vec[2];
   vec[0].iov_base = begin() + writer_index_;
   vec[0].iov_len = writable_bytes;
-  vec[1].iov_base = extrabuf;
-  vec[1].iov_len = sizeof(extrabuf);
+  vec[1].iov_base = t_read_scratch;
+  vec[1].iov_len = sizeof(t_read_scratch);
 
-  const int iov_cnt = writable_bytes < sizeof(extrabuf) ? 2 : 1;
+  const int iov_cnt = writable_bytes < sizeof(t_read_scratch) ? 2 : 1;
   const auto n = ::readv(fd, vec, iov_cnt);
 
   if (n < 0) {
@@ -33,10 +75,10 @@ ssize_t Buffer::readFd(int fd, int *saveErrno) {
   } else if (n <= writable_bytes) {
     writer_index_ += n;
   } else {
-    writer_index_ = buffer_.size();
-    append(extrabuf, n - writable_bytes);
+    writer_index_ = capacity_;
+    append(t_read_scratch, n - writable_bytes);
   }
   return n;
 }
 
-} // namespace bamboo
\ No newline at end of file
+} // namespace bamboo
@@ -1,10 +1,14 @@
 #pragma once
 
+#include "base/ByteScan.h"
 #include "base/Macro.h"
+#include "net/ChunkPool.h"
+
+#include <assert.h>
+#include <string.h>
 
 #include <algorithm>
 #include <string>
-#include <vector>
 
 namespace bamboo {
 
@@ -23,24 +27,56 @@ public:
   static constexpr size_t kCheapPrepend = 8;
   static constexpr size_t kInitialSize = 1024;
 
+  // with an initial_size of 0 nothing is allocated until bytes are
+  // written, storage that fits a chunk is borrowed from the ChunkPool
   explicit Buffer(size_t initial_size = kInitialSize);
 
   DISALLOW_COPY(Buffer)
 
+  ~Buffer() { freeStorage(); }
+
   size_t readableBytes() const { return writer_index_ - reader_index_; }
 
-  size_t writeableBytes() const { return buffer_.size() - writer_index_; }
+  size_t writeableBytes() const { return capacity_ - writer_index_; }
   size_t prependableBytes() const { return reader_index_; }
+  // bytes allocated
+  size_t internalCapacity() const {
+    return storage_ == kNoStorage ? 0 : capacity_;
+  }
   const char *peek() const { return begin() + reader_index_; }
 
+  // the scans below resume where the previous one found no '\n', a
+  // partial command is not scanned again after every read
   const char *findCRLF() const {
-    const char *crlf = std::search(peek(), beginWrite(), kCRLF, kCRLF + 2);
-    return crlf == beginWrite() ? nullptr : crlf;
+    const char *eol = findEOL();
+    if (eol == nullptr) {
+      return nullptr;
+    }
+    if (eol > peek() && eol[-1] == '\r') {
+      return eol - 1;
+    }
+    return ByteScan::findCRLF(eol, beginWrite());
+  }
+
+  const char *findEOL() const {
+    const char *eol = ByteScan::find(peek() + scanned_, beginWrite(), '\n');
+    noteScan(eol);
+    return eol;
+  }
+
+  const char *findEOL(const char *start) const {
+    return findByte(start, '\n');
+  }
+
+  // first c at or after start
+  const char *findByte(const char *start, char c) const {
+    return ByteScan::find(start, beginWrite(), c);
   }
 
   void retrieve(size_t len) {
     if (len < readableBytes()) {
       reader_index_ += len;
+      scanned_ = scanned_ > len ? scanned_ - len : 0;
     } else {
       retrieveAll();
     }
@@ -48,7 +84,10 @@ public:
 
   void retrieveUntil(const char *end) { retrieve(end - peek()); }
 
-  void retrieveAll() { reader_index_ = writer_index_ = kCheapPrepend; }
+  void retrieveAll() {
+    reader_index_ = writer_index_ = kCheapPrepend;
+    scanned_ = 0;
+  }
 
   std::string retrieveAllString() { return retrieveAsString(readableBytes()); }
 
@@ -76,23 +115,81 @@ public:
 
   const char *beginWrite() const { return begin() + writer_index_; }
 
+  // give back memory beyond the readable bytes and reserve
+  void shrink(size_t reserve) {
+    size_t readable = readableBytes();
+    if (readable + reserve == 0) {
+      release();
+    } else {
+      reallocate(kCheapPrepend + readable + reserve, false);
+    }
+  }
+
+  // give all storage back, nothing may be readable
+  void release() {
+    assert(readableBytes() == 0);
+    freeStorage();
+    storage_ = kNoStorage;
+    capacity_ = kCheapPrepend;
+    reader_index_ = writer_index_ = kCheapPrepend;
+    scanned_ = 0;
+  }
+
+  // give back what an idle reader does not need: all storage once drained,
+  // and most of it when a burst grew the buffer past a chunk and little of
+  // it is in use
+  void reclaim() {
+    size_t readable = readableBytes();
+    if (readable == 0) {
+      if (storage_ != kNoStorage) {
+        release();
+      }
+    } else if (capacity_ > BufferChunk::kSize && readable < capacity_ / 4) {
+      reallocate(kCheapPrepend + 2 * readable, true);
+    }
+  }
+
   ssize_t readFd(int fd, int *saveErrno);
 
 private:
-  char *begin() { return &*buffer_.begin(); }
+  char *begin() { return storage_; }
 
-  const char *begin() const { return &*buffer_.begin(); }
+  const char *begin() const { return storage_; }
 
   void makeSpace(std::size_t len) {
-    if (writeableBytes() < len) {
-      buffer_.resize(writer_index_ + len + 1);
+    size_t readable = readableBytes();
+    if (writeableBytes() + prependableBytes() < len + kCheapPrepend) {
+      reallocate(std::max(2 * capacity_, kCheapPrepend + readable + len),
+                 true);
+    } else {
+      // reuse the space of retrieved bytes instead of growing
+      memmove(begin() + kCheapPrepend, peek(), readable);
+      reader_index_ = kCheapPrepend;
+      writer_index_ = reader_index_ + readable;
     }
   }
 
+  // readable bytes up to found, or all of them, hold no '\n'
+  void noteScan(const char *found) const {
+    scanned_ = (found != nullptr ? found : beginWrite()) - peek();
+  }
+
+  // move the readable bytes to storage of at least capacity bytes, a chunk
+  // of the pool if pooled and it fits
+  void reallocate(size_t capacity, bool pooled);
+
+  void freeStorage();
+
   size_t reader_index_;
   size_t writer_index_;
-  std::vector<char> buffer_;
-
-  static const char kCRLF[];
+  // kNoStorage, chunk_->data or allocated with new[]
+  char *storage_;
+  size_t capacity_;
+  BufferChunk *chunk_{nullptr};
+  // readable bytes known to hold no '\n'
+  mutable size_t scanned_{0};
+
+  // prependable bytes of a buffer without storage
+  static char kNoStorage[kCheapPrepend];
 };
 } // namespace bamboo
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "base/Task.h"
+
 #include <functional>
 #include <memory>
 
@@ -11,7 +13,7 @@ class TimeStamp;
 
 using TcpConnectionPtr = std::shared_ptr<TcpConnection>;
 
-using TimerCallback = std::function<void()>;
+using TimerCallback = Task<void()>;
 
 using ConnectionCallback = std::function<void(const TcpConnectionPtr &)>;
 
@@ -25,6 +27,9 @@ using MessageCallback =
 using HighWaterMarkCallback =
     std::function<void(const TcpConnectionPtr &, size_t)>;
 
+using InputLimitCallback =
+    std::function<void(const TcpConnectionPtr &, size_t)>;
+
 void defaultConnectionCallback(const TcpConnectionPtr &conn);
 void defaultMessageCallback(const TcpConnectionPtr &conn, Buffer *buffer,
                             TimeStamp receiveTime);
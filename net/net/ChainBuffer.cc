@@ -0,0 +1,102 @@
+#include "net/ChainBuffer.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+
+namespace bamboo {
+
+constexpr int ChainBuffer::kMaxIovecs;
+
+void ChainBuffer::append(const char *data, size_t len) {
+  readable_ += len;
+  while (len > 0) {
+    if (tail_ == nullptr || tail_->writeableBytes() == 0) {
+      auto chunk = ChunkPool::get();
+      if (tail_ == nullptr) {
+        head_ = chunk;
+      } else {
+        tail_->next = chunk;
+      }
+      tail_ = chunk;
+      ++chunks_;
+    }
+    size_t n = std::min(len, tail_->writeableBytes());
+    memcpy(tail_->data + tail_->write_index, data, n);
+    tail_->write_index += n;
+    data += n;
+    len -= n;
+  }
+}
+
+void ChainBuffer::retrieve(size_t len) {
+  if (len >= readable_) {
+    retrieveAll();
+    return;
+  }
+  readable_ -= len;
+  while (len > 0) {
+    size_t n = std::min(len, head_->readableBytes());
+    head_->read_index += n;
+    len -= n;
+    if (head_->readableBytes() == 0) {
+      popFront();
+    }
+  }
+}
+
+void ChainBuffer::retrieveAll() {
+  while (head_ != nullptr) {
+    popFront();
+  }
+  readable_ = 0;
+}
+
+std::string ChainBuffer::retrieveAllString() {
+  std::string res;
+  res.reserve(readable_);
+  for (auto chunk = head_; chunk != nullptr; chunk = chunk->next) {
+    res.append(chunk->data + chunk->read_index, chunk->readableBytes());
+  }
+  retrieveAll();
+  return res;
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int *savedErrno) {
+  struct iovec vec[kMaxIovecs];
+  int count = 0;
+  for (auto chunk = head_; chunk != nullptr && count < kMaxIovecs;
+       chunk = chunk->next) {
+    if (chunk->readableBytes() == 0) {
+      continue;
+    }
+    vec[count].iov_base = chunk->data + chunk->read_index;
+    vec[count].iov_len = chunk->readableBytes();
+    ++count;
+  }
+  if (count == 0) {
+    return 0;
+  }
+  auto n = ::writev(fd, vec, count);
+  if (n < 0) {
+    *savedErrno = errno;
+  } else {
+    retrieve(static_cast<size_t>(n));
+  }
+  return n;
+}
+
+void ChainBuffer::popFront() {
+  auto chunk = head_;
+  head_ = chunk->next;
+  if (head_ == nullptr) {
+    tail_ = nullptr;
+  }
+  --chunks_;
+  ChunkPool::put(chunk);
+}
+
+} // namespace bamboo
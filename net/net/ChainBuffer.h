@@ -0,0 +1,55 @@
+#pragma once
+
+#include "base/Macro.h"
+#include "net/ChunkPool.h"
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <string>
+
+namespace bamboo {
+
+// output buffer made of a chain of pooled chunks
+// appending fills the last chunk and links new ones, bytes already queued
+// never move and the buffer never reallocates; writeFd() hands the whole
+// chain to one writev
+class ChainBuffer {
+public:
+  ChainBuffer() = default;
+
+  DISALLOW_COPY(ChainBuffer)
+
+  ~ChainBuffer() { retrieveAll(); }
+
+  size_t readableBytes() const { return readable_; }
+
+  // chunks held, including a partly written last one
+  size_t chunks() const { return chunks_; }
+
+  void append(const char *data, size_t len);
+
+  void append(const std::string &str) { append(str.data(), str.size()); }
+
+  void retrieve(size_t len);
+
+  void retrieveAll();
+
+  std::string retrieveAllString();
+
+  // write as much as the socket takes, at most kMaxIovecs chunks per call,
+  // written bytes are retrieved
+  ssize_t writeFd(int fd, int *savedErrno);
+
+private:
+  static constexpr int kMaxIovecs = 64;
+
+  void popFront();
+
+  BufferChunk *head_{nullptr};
+  BufferChunk *tail_{nullptr};
+  size_t readable_{0};
+  size_t chunks_{0};
+};
+
+} // namespace bamboo
@@ -1,9 +1,9 @@
 #pragma once
 
 #include "base/Macro.h"
+#include "base/Task.h"
 #include "base/TimeStamp.h"
 
-#include <functional>
 #include <memory>
 
 namespace bamboo {
@@ -14,8 +14,8 @@ class EventLoop;
 // run callback function according to its events
 class Channel {
 public:
-  using EventCallback = std::function<void()>;
-  using ReadEventCallback = std::function<void(TimeStamp)>;
+  using EventCallback = Task<void()>;
+  using ReadEventCallback = Task<void(TimeStamp)>;
 
   Channel(EventLoop *loop, int fd);
 
@@ -73,6 +73,12 @@ public:
 
   bool isNoneEvent() const { return events_ == kNoneEvent; }
 
+  // the handlers consume everything until EAGAIN, so the poller only needs
+  // to report new readiness; set before the first enableReading()
+  void setEdgeTriggered(bool on) { edge_triggered_ = on; }
+
+  bool edgeTriggered() const { return edge_triggered_; }
+
   int index() { return index_; }
 
   void setIndex(int idx) { index_ = idx; }
@@ -105,6 +111,7 @@ private:
   bool event_handing_{false};
   bool added_to_loop_{false};
   bool log_hup_{true};
+  bool edge_triggered_{false};
 
   EventLoop *loop_;
   // tie his own TcpConnection
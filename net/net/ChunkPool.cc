@@ -0,0 +1,52 @@
+#include "net/ChunkPool.h"
+
+namespace bamboo {
+
+constexpr size_t BufferChunk::kSize;
+constexpr size_t ChunkPool::kMaxFreeChunks;
+
+namespace {
+thread_local ChunkPool t_pool;
+// chunks released by thread local destructors running after t_pool's
+thread_local bool t_pool_gone = false;
+} // namespace
+
+ChunkPool::~ChunkPool() {
+  while (free_ != nullptr) {
+    auto chunk = free_;
+    free_ = chunk->next;
+    delete chunk;
+  }
+  free_count_ = 0;
+  t_pool_gone = true;
+}
+
+BufferChunk *ChunkPool::get() {
+  BufferChunk *chunk = nullptr;
+  auto &pool = t_pool;
+  if (!t_pool_gone && pool.free_ != nullptr) {
+    chunk = pool.free_;
+    pool.free_ = chunk->next;
+    --pool.free_count_;
+  } else {
+    chunk = new BufferChunk;
+  }
+  chunk->next = nullptr;
+  chunk->read_index = chunk->write_index = 0;
+  return chunk;
+}
+
+void ChunkPool::put(BufferChunk *chunk) {
+  if (t_pool_gone || t_pool.free_count_ >= kMaxFreeChunks) {
+    delete chunk;
+    return;
+  }
+  auto &pool = t_pool;
+  chunk->next = pool.free_;
+  pool.free_ = chunk;
+  ++pool.free_count_;
+}
+
+size_t ChunkPool::freeChunks() { return t_pool_gone ? 0 : t_pool.free_count_; }
+
+} // namespace bamboo
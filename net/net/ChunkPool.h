@@ -0,0 +1,52 @@
+#pragma once
+
+#include "base/Macro.h"
+
+#include <stddef.h>
+
+namespace bamboo {
+
+// fixed size storage borrowed by a ChainBuffer or Buffer
+struct BufferChunk {
+  static constexpr size_t kSize = 16 * 1024;
+
+  size_t readableBytes() const { return write_index - read_index; }
+
+  size_t writeableBytes() const { return kSize - write_index; }
+
+  BufferChunk *next{nullptr};
+  size_t read_index{0};
+  size_t write_index{0};
+  // left uninitialized, only written bytes are read
+  char data[kSize];
+};
+
+// free chunks of the calling thread, i.e. of the EventLoop it runs, so
+// buffers can borrow storage while they hold data without going to the
+// allocator every time; at most kMaxFreeChunks are kept, the rest goes
+// back to the allocator
+class ChunkPool {
+public:
+  static constexpr size_t kMaxFreeChunks = 64;
+
+  // from the pool of the calling thread
+  static BufferChunk *get();
+
+  // to the pool of the calling thread, or freed if it is full or already
+  // gone at thread exit
+  static void put(BufferChunk *chunk);
+
+  static size_t freeChunks();
+
+  ChunkPool() = default;
+
+  DISALLOW_COPY(ChunkPool)
+
+  ~ChunkPool();
+
+private:
+  BufferChunk *free_{nullptr};
+  size_t free_count_{0};
+};
+
+} // namespace bamboo
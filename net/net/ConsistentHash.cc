@@ -0,0 +1,30 @@
+#include "net/ConsistentHash.h"
+
+#include <algorithm>
+
+namespace bamboo {
+
+int ConsistentHash::addNode(const std::string &name) {
+  int node = node_count_++;
+  for (int i = 0; i < virtual_nodes_; ++i) {
+    auto vnode = name + "#" + std::to_string(i);
+    ring_.emplace_back(hash(vnode.data(), vnode.size()), node);
+  }
+  std::sort(ring_.begin(), ring_.end());
+  return node;
+}
+
+int ConsistentHash::nodeOf(const char *key, size_t len) const {
+  if (ring_.empty()) {
+    return -1;
+  }
+  // first point clockwise from the key, wrap around at the end
+  Point point(hash(key, len), -1);
+  auto it = std::lower_bound(ring_.begin(), ring_.end(), point);
+  if (it == ring_.end()) {
+    it = ring_.begin();
+  }
+  return it->second;
+}
+
+} // namespace bamboo
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "base/Hash.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bamboo {
+
+// consistent hash ring with virtual nodes
+// adding a node only moves about 1/n of the keys
+class ConsistentHash {
+public:
+  explicit ConsistentHash(int virtualNodes = kDefaultVirtualNodes)
+      : virtual_nodes_(virtualNodes) {}
+
+  // return node id, ids start from 0 in order of addition
+  // name decides the positions of the node on the ring
+  int addNode(const std::string &name);
+
+  // return node id of key, -1 if ring is empty
+  int nodeOf(const char *key, size_t len) const;
+
+  int nodeOf(const std::string &key) const {
+    return nodeOf(key.data(), key.size());
+  }
+
+  int nodeCount() const { return node_count_; }
+
+  static uint64_t hash(const char *data, size_t len) {
+    return hash64(data, len);
+  }
+
+  static constexpr int kDefaultVirtualNodes = 160;
+
+private:
+  using Point = std::pair<uint64_t, int>;
+
+  const int virtual_nodes_;
+  int node_count_{0};
+  // sorted by hash
+  std::vector<Point> ring_;
+};
+
+} // namespace bamboo
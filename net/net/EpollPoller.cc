@@ -26,7 +26,7 @@ EpollPoller::EpollPoller(EventLoop *loop)
 EpollPoller::~EpollPoller() { ::close(epollfd_); }
 
 TimeStamp EpollPoller::poll(int timeoutMs, ChannelList *active_channels) {
-  LOG_TRACE << "fd total count " << channels_.size();
+  LOG_TRACE << "fd total count " << numChannels();
   int num_events =
       ::epoll_wait(epollfd_, &*events_.begin(), events_.size(), timeoutMs);
   int saved_err = errno;
@@ -51,7 +51,14 @@ TimeStamp EpollPoller::poll(int timeoutMs, ChannelList *active_channels) {
 void EpollPoller::fillActiveChannels(int numEvents,
                                      ChannelList *active_channels) const {
   for (int i = 0; i < numEvents; ++i) {
-    auto channel = static_cast<Channel *>(events_[i].data.ptr);
+    uint64_t data = events_[i].data.u64;
+    int fd = static_cast<int>(data & 0xffffffff);
+    auto channel = channelOf(fd);
+    if (channel == nullptr ||
+        generationOf(fd) != static_cast<uint32_t>(data >> 32)) {
+      LOG_TRACE << "stale event of fd " << fd;
+      continue;
+    }
     channel->setRevents(events_[i].events);
     active_channels->push_back(channel);
   }
@@ -65,17 +72,15 @@ void EpollPoller::updateChannel(Channel *channel) {
   if (index == kNew || index == kDeleted) {
     int fd = channel->fd();
     if (index == kNew) {
-      assert(channels_.find(fd) == channels_.end());
-      channels_[fd] = channel;
+      addChannel(channel);
     } else {
-      assert(channels_.find(fd) != channels_.end());
+      assert(channelOf(fd) == channel);
     }
 
     channel->setIndex(kAdded);
     update(EPOLL_CTL_ADD, channel);
   } else {
-    assert(channels_.find(channel->fd()) != channels_.end());
-    assert(channels_[channel->fd()] == channel);
+    assert(channelOf(channel->fd()) == channel);
     assert(index == kAdded);
     if (channel->isNoneEvent()) {
       update(EPOLL_CTL_DEL, channel);
@@ -90,16 +95,14 @@ void EpollPoller::removeChannel(Channel *channel) {
   Poller::assertInLoopThread();
   int fd = channel->fd();
   LOG_TRACE << "fd = " << fd;
-  assert(channels_.find(fd) != channels_.end());
-  assert(channels_[fd] == channel);
+  assert(channelOf(fd) == channel);
   assert(channel->isNoneEvent());
   int index = channel->index();
   assert(index == kAdded || index == kDeleted);
-  size_t n = channels_.erase(fd);
-  assert(1 == n);
   if (index == kAdded) {
     update(EPOLL_CTL_DEL, channel);
   }
+  eraseChannel(channel);
   channel->setIndex(kNew);
 }
 
@@ -107,8 +110,12 @@ void EpollPoller::update(int operation, Channel *channel) {
   struct epoll_event event;
   memset(&event, 0, sizeof(event));
   event.events = channel->events();
-  event.data.ptr = channel;
+  if (channel->edgeTriggered()) {
+    event.events |= EPOLLET;
+  }
   int fd = channel->fd();
+  event.data.u64 = static_cast<uint64_t>(generationOf(fd)) << 32 |
+                   static_cast<uint32_t>(fd);
   auto operation_str = operationToString(operation);
   LOG_TRACE << "epoll_ctl op = " << operation_str << " fd = " << fd
             << " events = {" << channel->eventsToString() << "}";
@@ -8,8 +8,11 @@
 #include "net/TimerQueue.h"
 
 #include <assert.h>
+#include <stdint.h>
 #include <sys/eventfd.h>
 
+#include <algorithm>
+
 namespace bamboo {
 
 namespace {
@@ -18,6 +21,11 @@ thread_local EventLoop *t_loopInThisThread = nullptr;
 
 constexpr int kPollTimeMs = 1000;
 
+// functors run between two checks of the functor time budget
+constexpr size_t kFunctorChunk = 16;
+
+void runFunctor(const EventLoop::Functor &func) { func(); }
+
 int createEventfd() {
   int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
   if (fd < 0) {
@@ -29,7 +37,7 @@ int createEventfd() {
 
 EventLoop::EventLoop()
     : tid_(CurrentThread::tid()), poller_(Poller::newDefaultPoller(this)),
-      wakeup_fd_(createEventfd()),
+      timer_queue_(new TimerQueue(this)), wakeup_fd_(createEventfd()),
       wakeup_channel_(new Channel(this, wakeup_fd_)),
       current_active_channel_(nullptr) {
   LOG_DEBUG << "EventLoop created " << this << " in thread " << tid_;
@@ -42,6 +50,8 @@ EventLoop::EventLoop()
   }
 
   wakeup_channel_->setReadCallback(std::bind(&EventLoop::handleRead, this));
+  // one read resets the eventfd counter
+  wakeup_channel_->setEdgeTriggered(true);
   wakeup_channel_->enableReading();
 }
 
@@ -60,15 +70,52 @@ void EventLoop::loop() {
   looping_ = true;
   quit_ = false;
   LOG_TRACE << "EventLoop " << this << " start looping";
+  int64_t last_active = 0;
   while (!quit_) {
     active_channels_.clear();
-    pool_return_time_ = poller_->poll(kPollTimeMs, &active_channels_);
+    bool spin = busy_poll_micros_ > 0 &&
+                pool_return_time_.microSecondsSinceEpoch() - last_active <
+                    busy_poll_micros_;
+    // functors left over by the budget only need the events polled
+    bool backlog = hasPendingFunctors();
+    pool_return_time_ = poller_->poll(spin || backlog ? 0 : kPollTimeMs,
+                                      &active_channels_);
+    now_ = pool_return_time_;
     for (auto chan : active_channels_) {
       current_active_channel_ = chan;
       current_active_channel_->handleEvent(pool_return_time_);
     }
     current_active_channel_ = nullptr;
-    doPendingFunctors();
+    // the clock is read again only for the consumers of precise times,
+    // otherwise the functors see the time poll returned
+    bool timed = iteration_timing_ || busy_poll_micros_ > 0 ||
+                 functor_budget_micros_ > 0 || slow_iteration_callback_;
+    TimeStamp handled_time(timed ? TimeStamp::now() : pool_return_time_);
+    now_ = handled_time;
+    size_t functors = doPendingFunctors();
+    TimeStamp end_time(timed ? TimeStamp::now() : handled_time);
+    if (!active_channels_.empty() || functors > 0) {
+      last_active = end_time.microSecondsSinceEpoch();
+    } else if (spin) {
+      stats_.onEmptySpin();
+      continue;
+    }
+
+    IterationInfo info;
+    info.iteration = static_cast<int64_t>(stats_.iterations());
+    info.events = active_channels_.size();
+    info.handle_event_time = handled_time.microSecondsSinceEpoch() -
+                             pool_return_time_.microSecondsSinceEpoch();
+    info.pending_functors_time = end_time.microSecondsSinceEpoch() -
+                                 handled_time.microSecondsSinceEpoch();
+    info.functors = functors;
+    stats_.onIteration(info);
+    if (slow_iteration_callback_ &&
+        info.handle_event_time + info.pending_functors_time >
+            slow_iteration_budget_) {
+      stats_.onSlowIteration();
+      slow_iteration_callback_(info);
+    }
   }
 
   LOG_TRACE << "EventLoop " << this << " stop looping";
@@ -84,41 +131,65 @@ void EventLoop::quit() {
 
 TimeStamp EventLoop::pollReturnTime() const { return pool_return_time_; }
 
-void EventLoop::runInLoop(Functor func) {
+TimeStamp EventLoop::now() const {
+  if (isInLoopThread() && looping_) {
+    return now_;
+  }
+  return TimeStamp::now();
+}
+
+void EventLoop::runInLoop(Functor func, Priority priority) {
   if (isInLoopThread()) {
     func();
   } else {
-    queueInLoop(std::move(func));
+    queueInLoop(std::move(func), priority);
   }
 }
 
-void EventLoop::queueInLoop(Functor func) {
-  std::unique_lock<std::mutex> lck(mutex_);
-  pending_functors_.emplace_back(std::move(func));
-  lck.unlock();
+void EventLoop::queueInLoop(Functor func, Priority priority) {
+  pending_functors_[priority].push(std::move(func));
 
-  if (!isInLoopThread() || calling_pending_functors_) {
+  if ((!isInLoopThread() || calling_pending_functors_) &&
+      !wakeup_pending_.exchange(true)) {
     wakeup();
   }
 }
 
+size_t EventLoop::queueSize() const {
+  size_t n = 0;
+  for (const auto &queue : pending_functors_) {
+    n += queue.size();
+  }
+  return n;
+}
+
+bool EventLoop::hasPendingFunctors() const {
+  for (const auto &queue : pending_functors_) {
+    if (!queue.empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
 TimerId EventLoop::runAt(const TimeStamp &time, TimerCallback cb) {
   return timer_queue_->addTimer(std::move(cb), time, 0.0);
 }
 
 TimerId EventLoop::runAfter(double delay, TimerCallback cb) {
-  TimeStamp time(addTime(TimeStamp::now(), delay));
+  TimeStamp time(addTime(now(), delay));
   return runAt(time, std::move(cb));
 }
 
 TimerId EventLoop::runEvery(double interval, TimerCallback cb) {
-  TimeStamp time(addTime(TimeStamp::now(), interval));
+  TimeStamp time(addTime(now(), interval));
   return timer_queue_->addTimer(std::move(cb), time, interval);
 }
 
 void EventLoop::cancel(TimerId timerId) { timer_queue_->cancel(timerId); }
 
 void EventLoop::wakeup() {
+  stats_.onWakeup();
   uint64_t one = 1;
   ssize_t wroten_bytes = write(wakeup_fd_, &one, sizeof one);
   if (wroten_bytes != sizeof(one)) {
@@ -158,17 +229,47 @@ void EventLoop::handleRead() {
   }
 }
 
-void EventLoop::doPendingFunctors() {
-  std::vector<Functor> functors;
+size_t EventLoop::doPendingFunctors() {
   calling_pending_functors_ = true;
-  {
-    std::lock_guard<std::mutex> guard(mutex_);
-    functors.swap(pending_functors_);
+  // cleared before draining, so a producer that pushes after the drain
+  // has passed its item wakes the loop again
+  wakeup_pending_.store(false);
+  size_t n = pending_functors_[kUrgent].consume(runFunctor);
+  if (functor_budget_count_ == 0 && functor_budget_micros_ == 0) {
+    n += pending_functors_[kNormal].consume(runFunctor);
+    n += pending_functors_[kBackground].consume(runFunctor);
+  } else {
+    n += doPendingFunctorsWithBudget();
   }
+  calling_pending_functors_ = false;
+  return n;
+}
 
-  for (const auto &func : functors) {
-    func();
+size_t EventLoop::doPendingFunctorsWithBudget() {
+  size_t limit = functor_budget_count_ > 0 ? functor_budget_count_ : SIZE_MAX;
+  int64_t deadline =
+      functor_budget_micros_ > 0
+          ? now().microSecondsSinceEpoch() + functor_budget_micros_
+          : INT64_MAX;
+  size_t n = 0;
+  for (int priority = kNormal; priority < kNumPriorities; ++priority) {
+    auto &queue = pending_functors_[priority];
+    // the clock is read once per chunk, and only for a time budget
+    while (n < limit &&
+           (deadline == INT64_MAX ||
+            TimeStamp::now().microSecondsSinceEpoch() < deadline)) {
+      size_t chunk = std::min(kFunctorChunk, limit - n);
+      size_t consumed = queue.consume(runFunctor, chunk);
+      n += consumed;
+      if (consumed < chunk) {
+        break;
+      }
+    }
   }
-  calling_pending_functors_ = false;
+  if (!pending_functors_[kNormal].empty() ||
+      !pending_functors_[kBackground].empty()) {
+    stats_.onFunctorBudgetExhausted();
+  }
+  return n;
 }
 } // namespace bamboo
\ No newline at end of file
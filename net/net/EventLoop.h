@@ -1,14 +1,16 @@
 #pragma once
 
 #include "base/Macro.h"
+#include "base/MpscQueue.h"
+#include "base/Task.h"
 #include "base/TimeStamp.h"
 #include "net/CallBack.h"
+#include "net/EventLoopStats.h"
 #include "net/TimerId.h"
 
 #include <atomic>
 #include <functional>
 #include <memory>
-#include <mutex>
 #include <thread>
 #include <vector>
 
@@ -20,7 +22,15 @@ class TimerQueue;
 
 class EventLoop {
 public:
-  using Functor = std::function<void()>;
+  using Functor = Task<void()>;
+  using SlowIterationCallback = std::function<void(const IterationInfo &)>;
+
+  // queued functors run by priority after the events of an iteration,
+  // urgent ones always, the others within the functor budget
+  // urgent: timers and connection I/O from other threads, i.e. sends,
+  // shutdown, close and teardown; background: housekeeping that can wait
+  // for a quiet iteration, e.g. the progress of a replica's full sync
+  enum Priority { kUrgent, kNormal, kBackground, kNumPriorities };
 
   EventLoop();
 
@@ -33,16 +43,58 @@ public:
   void quit();
   TimeStamp pollReturnTime() const;
 
+  // time cached by the loop, taken when poll returns and, when iterations
+  // are timed, again before the pending functors; TimeStamp::now() outside
+  // of loop() or in other threads
+  TimeStamp now() const;
+
+  // number of loop iterations, safe to call from other threads
+  int64_t iteration() const { return stats_.iterations(); }
+
+  // counters of this loop, safe to read from other threads
+  const EventLoopStats &stats() const { return stats_; }
+
+  EventLoopStats &stats() { return stats_; }
+
+  // cb runs in the loop thread after an iteration whose events and
+  // functors took longer than budgetMicros, not thread safe
+  void setSlowIterationCallback(int64_t budgetMicros,
+                                SlowIterationCallback cb) {
+    slow_iteration_budget_ = budgetMicros;
+    slow_iteration_callback_ = std::move(cb);
+  }
+
+  // measure the time of the events and the functors of every iteration for
+  // stats(); busy poll, a time budget and a slow iteration callback time
+  // them anyway, otherwise both stay 0; call in the loop thread
+  void setIterationTiming(bool on) { iteration_timing_ = on; }
+
+  // poll with a zero timeout until micros have passed without events or
+  // functors, then block again; spends the core on lower wakeup latency,
+  // 0 disables, call in the loop thread
+  void setBusyPoll(int64_t micros) { busy_poll_micros_ = micros; }
+
+  // run at most count normal and background functors and spend at most
+  // micros on them per iteration, the rest waits for the next iteration
+  // without blocking in poll; 0 is no limit, call in the loop thread
+  void setFunctorBudget(size_t count, int64_t micros) {
+    functor_budget_count_ = count;
+    functor_budget_micros_ = micros;
+  }
+
   // Runs callback immediately in the loop thread.
   // It wakes up the loop, and run the cb.
   // If in the same loop thread, cb is run within the function.
   // Safe to call from other threads.
-  void runInLoop(Functor func);
+  void runInLoop(Functor func, Priority priority = kNormal);
 
   // Queues callback in the loop thread.
   // Runs after finish pooling.
   // Safe to call from other threads.
-  void queueInLoop(Functor func);
+  void queueInLoop(Functor func, Priority priority = kNormal);
+
+  // number of queued functors, safe to call from other threads
+  size_t queueSize() const;
 
   // at some time point run timer
   TimerId runAt(const TimeStamp &time, TimerCallback cb);
@@ -67,7 +119,12 @@ public:
 private:
   // for wake up event
   void handleRead();
-  void doPendingFunctors();
+  // return number of functors run
+  size_t doPendingFunctors();
+
+  size_t doPendingFunctorsWithBudget();
+
+  bool hasPendingFunctors() const;
 
   std::atomic<bool> looping_{false};
   std::atomic<bool> quit_{false};
@@ -75,6 +132,7 @@ private:
 
   pid_t tid_;
   TimeStamp pool_return_time_;
+  TimeStamp now_;
   std::unique_ptr<Poller> poller_;
 
   std::unique_ptr<TimerQueue> timer_queue_;
@@ -85,7 +143,17 @@ private:
   std::vector<Channel *> active_channels_;
   Channel *current_active_channel_;
 
-  std::mutex mutex_;
-  std::vector<Functor> pending_functors_;// guard by mutex_
+  EventLoopStats stats_;
+  bool iteration_timing_{false};
+  int64_t slow_iteration_budget_{0};
+  int64_t busy_poll_micros_{0};
+  size_t functor_budget_count_{0};
+  int64_t functor_budget_micros_{0};
+  SlowIterationCallback slow_iteration_callback_;
+
+  // lock free, producers only write the eventfd when wakeup_pending_ was
+  // clear, i.e. the first push after the loop started draining
+  MpscQueue<Functor> pending_functors_[kNumPriorities];
+  std::atomic<bool> wakeup_pending_{false};
 };
 } // namespace bamboo
\ No newline at end of file
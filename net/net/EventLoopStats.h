@@ -0,0 +1,109 @@
+#pragma once
+
+#include "base/Macro.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+namespace bamboo {
+
+// what one loop iteration did, times in micro seconds
+struct IterationInfo {
+  int64_t iteration;
+  size_t events;
+  int64_t handle_event_time;
+  int64_t pending_functors_time;
+  size_t functors;
+};
+
+// counters of an EventLoop
+// written by the loop thread (wakeups by any thread), read from any thread
+class EventLoopStats {
+public:
+  EventLoopStats() = default;
+
+  DISALLOW_COPY(EventLoopStats)
+
+  void onIteration(const IterationInfo &info) {
+    add(&iterations_, 1);
+    add(&events_, info.events);
+    add(&handle_event_time_, info.handle_event_time);
+    add(&pending_functors_time_, info.pending_functors_time);
+    add(&functors_, info.functors);
+    if (info.events > max_events_.load(std::memory_order_relaxed)) {
+      max_events_.store(info.events, std::memory_order_relaxed);
+    }
+  }
+
+  void onSlowIteration() { add(&slow_iterations_, 1); }
+
+  void onWakeup() { wakeups_.fetch_add(1, std::memory_order_relaxed); }
+
+  void onTimerFires(size_t n) { add(&timer_fires_, n); }
+
+  void onEmptySpin() { add(&empty_spins_, 1); }
+
+  void onFunctorBudgetExhausted() { add(&functor_budget_exhausted_, 1); }
+
+  uint64_t iterations() const { return load(iterations_); }
+
+  // active channels returned by poll, in total and at most in one poll
+  uint64_t events() const { return load(events_); }
+
+  uint64_t maxEventsPerPoll() const { return load(max_events_); }
+
+  double eventsPerPoll() const {
+    uint64_t n = iterations();
+    return n > 0 ? static_cast<double>(events()) / n : 0.0;
+  }
+
+  // micro seconds spent in Channel::handleEvent
+  uint64_t handleEventTime() const { return load(handle_event_time_); }
+
+  // micro seconds spent running queued functors
+  uint64_t pendingFunctorsTime() const { return load(pending_functors_time_); }
+
+  uint64_t functors() const { return load(functors_); }
+
+  // writes to the wakeup eventfd
+  uint64_t wakeups() const { return load(wakeups_); }
+
+  uint64_t timerFires() const { return load(timer_fires_); }
+
+  uint64_t slowIterations() const { return load(slow_iterations_); }
+
+  // busy polls that found nothing, not counted as iterations
+  uint64_t emptySpins() const { return load(empty_spins_); }
+
+  // iterations that left functors for the next one
+  uint64_t functorBudgetExhausted() const {
+    return load(functor_budget_exhausted_);
+  }
+
+private:
+  // single writer, no need for a locked add
+  static void add(std::atomic<uint64_t> *counter, uint64_t n) {
+    counter->store(counter->load(std::memory_order_relaxed) + n,
+                   std::memory_order_relaxed);
+  }
+
+  static uint64_t load(const std::atomic<uint64_t> &counter) {
+    return counter.load(std::memory_order_relaxed);
+  }
+
+  std::atomic<uint64_t> iterations_{0};
+  std::atomic<uint64_t> events_{0};
+  std::atomic<uint64_t> max_events_{0};
+  std::atomic<uint64_t> handle_event_time_{0};
+  std::atomic<uint64_t> pending_functors_time_{0};
+  std::atomic<uint64_t> functors_{0};
+  std::atomic<uint64_t> wakeups_{0};
+  std::atomic<uint64_t> timer_fires_{0};
+  std::atomic<uint64_t> slow_iterations_{0};
+  std::atomic<uint64_t> empty_spins_{0};
+  std::atomic<uint64_t> functor_budget_exhausted_{0};
+};
+
+} // namespace bamboo
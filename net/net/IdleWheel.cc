@@ -0,0 +1,66 @@
+#include "net/IdleWheel.h"
+
+#include "base/Logging.h"
+#include "net/EventLoop.h"
+#include "net/TcpConnection.h"
+
+#include <assert.h>
+
+namespace bamboo {
+
+IdleEntry::~IdleEntry() {
+  auto conn = conn_.lock();
+  if (conn && conn->connected()) {
+    LOG_INFO << "IdleWheel closes idle connection " << conn->name();
+    closed_->fetch_add(1, std::memory_order_relaxed);
+    conn->forceCloseInLoop();
+  }
+}
+
+IdleWheel::IdleWheel(EventLoop *loop, int timeoutSeconds)
+    : loop_(loop), buckets_(static_cast<size_t>(timeoutSeconds) + 1) {
+  assert(timeoutSeconds > 0);
+}
+
+IdleWheel::~IdleWheel() {
+  loop_->cancel(timer_);
+  for (auto &bucket : buckets_) {
+    for (auto &entry : bucket) {
+      entry->release();
+    }
+  }
+}
+
+void IdleWheel::start() {
+  std::weak_ptr<IdleWheel> weak(shared_from_this());
+  timer_ = loop_->runEvery(1.0, [weak]() {
+    auto wheel = weak.lock();
+    if (wheel) {
+      wheel->rotate();
+    }
+  });
+}
+
+void IdleWheel::touch(TcpConnection *conn) {
+  if (conn->idle_rotation_ == rotation_) {
+    return;
+  }
+  conn->idle_rotation_ = rotation_;
+  auto entry = conn->idle_entry_.lock();
+  if (!entry) {
+    entry = std::make_shared<IdleEntry>(conn->shared_from_this(), &closed_);
+    conn->idle_entry_ = entry;
+  }
+  buckets_[newest_].push_back(std::move(entry));
+}
+
+void IdleWheel::rotate() {
+  loop_->assertInLoopThread();
+  ++rotation_;
+  newest_ = (newest_ + 1) % buckets_.size();
+  // closing runs callbacks that may touch the new bucket
+  Bucket oldest;
+  oldest.swap(buckets_[newest_]);
+}
+
+} // namespace bamboo
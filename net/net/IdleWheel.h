@@ -0,0 +1,73 @@
+#pragma once
+
+#include "base/Macro.h"
+#include "net/CallBack.h"
+#include "net/TimerId.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace bamboo {
+
+class EventLoop;
+class TcpConnection;
+
+// reference of a connection in the buckets of an IdleWheel, closes the
+// connection when the last bucket holding it is dropped
+class IdleEntry {
+public:
+  IdleEntry(const TcpConnectionPtr &conn, std::atomic<uint64_t> *closed)
+      : conn_(conn), closed_(closed) {}
+
+  DISALLOW_COPY(IdleEntry)
+
+  ~IdleEntry();
+
+  // forget the connection, it is not closed
+  void release() { conn_.reset(); }
+
+private:
+  std::weak_ptr<TcpConnection> conn_;
+  std::atomic<uint64_t> *closed_;
+};
+
+// closes connections of a loop that neither read nor wrote for a timeout
+// timeout + 1 buckets rotate once a second, a read or a write that made
+// progress puts the entry of the connection in the newest bucket unless it
+// is there already, so touching is an integer compare most of the time; no
+// timer per connection
+// loop thread only, apart from start()
+class IdleWheel : public std::enable_shared_from_this<IdleWheel> {
+public:
+  IdleWheel(EventLoop *loop, int timeoutSeconds);
+
+  DISALLOW_COPY(IdleWheel)
+
+  ~IdleWheel();
+
+  // rotate every second until the wheel is gone
+  void start();
+
+  // conn read or wrote something
+  void touch(TcpConnection *conn);
+
+  // connections closed for being idle, safe to read from other threads
+  uint64_t closed() const { return closed_.load(std::memory_order_relaxed); }
+
+private:
+  using Bucket = std::vector<std::shared_ptr<IdleEntry>>;
+
+  void rotate();
+
+  EventLoop *loop_;
+  std::vector<Bucket> buckets_;
+  size_t newest_{0};
+  int64_t rotation_{0};
+  TimerId timer_;
+  std::atomic<uint64_t> closed_{0};
+};
+
+} // namespace bamboo
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "base/Macro.h"
+
+#include <stddef.h>
+
+#include <atomic>
+
+namespace bamboo {
+
+// memory of input buffers shared by a group of connections, each one
+// charges the capacity of its buffer; thread safe
+class InputBudget {
+public:
+  explicit InputBudget(size_t limit) : limit_(limit) {}
+
+  DISALLOW_COPY(InputBudget)
+
+  // a buffer grew from oldBytes to newBytes, or shrank
+  void update(size_t oldBytes, size_t newBytes) {
+    if (newBytes > oldBytes) {
+      used_.fetch_add(newBytes - oldBytes, std::memory_order_relaxed);
+    } else {
+      used_.fetch_sub(oldBytes - newBytes, std::memory_order_relaxed);
+    }
+    if (oldBytes == 0 && newBytes > 0) {
+      holders_.fetch_add(1, std::memory_order_relaxed);
+    } else if (oldBytes > 0 && newBytes == 0) {
+      holders_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  bool exceeded() const { return used() > limit_; }
+
+  // even split of the limit between the buffers charging something
+  size_t share() const {
+    size_t holders = holders_.load(std::memory_order_relaxed);
+    return holders > 1 ? limit_ / holders : limit_;
+  }
+
+  size_t used() const { return used_.load(std::memory_order_relaxed); }
+
+  size_t limit() const { return limit_; }
+
+private:
+  const size_t limit_;
+  std::atomic<size_t> used_{0};
+  std::atomic<size_t> holders_{0};
+};
+
+} // namespace bamboo
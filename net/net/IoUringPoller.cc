@@ -0,0 +1,310 @@
+#include "net/IoUringPoller.h"
+
+#include "base/Logging.h"
+#include "net/Channel.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace {
+constexpr int kNew = -1;
+constexpr int kAdded = 1;
+
+// completions of cancel requests carry this
+constexpr uint64_t kCancelUserData = ~uint64_t(0);
+
+// io_uring_enter takes a timeout and a larger cq ring from 5.11, multishot
+// poll arrived in 5.13 together with IORING_FEAT_RSRC_TAGS
+constexpr unsigned kRequiredFeatures = IORING_FEAT_SINGLE_MMAP |
+                                       IORING_FEAT_NODROP |
+                                       IORING_FEAT_EXT_ARG |
+                                       IORING_FEAT_RSRC_TAGS;
+
+uint64_t userDataOf(int fd, uint32_t generation) {
+  return static_cast<uint64_t>(generation) << 32 |
+         static_cast<uint32_t>(fd);
+}
+
+unsigned loadAcquire(const unsigned *p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+void storeRelease(unsigned *p, unsigned value) {
+  __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+} // namespace
+
+namespace bamboo {
+
+IoUringPoller::IoUringPoller(EventLoop *loop) : Poller(loop) {
+  if (!setup() && ring_fd_ >= 0) {
+    ::close(ring_fd_);
+    ring_fd_ = -1;
+  }
+}
+
+IoUringPoller::~IoUringPoller() {
+  if (sqes_ != nullptr) {
+    ::munmap(sqes_, sqes_size_);
+  }
+  if (ring_ != nullptr) {
+    ::munmap(ring_, ring_size_);
+  }
+  if (ring_fd_ >= 0) {
+    ::close(ring_fd_);
+  }
+}
+
+bool IoUringPoller::setup() {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  params.flags = IORING_SETUP_CLAMP;
+  ring_fd_ =
+      static_cast<int>(::syscall(__NR_io_uring_setup, kEntries, &params));
+  if (ring_fd_ < 0) {
+    LOG_WARN << "io_uring_setup: " << strerror_tl(errno);
+    return false;
+  }
+  if ((params.features & kRequiredFeatures) != kRequiredFeatures) {
+    LOG_WARN << "io_uring lacks features, has " << params.features;
+    return false;
+  }
+
+  // sq and cq rings share one mapping
+  size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  size_t cq_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  ring_size_ = std::max(sq_size, cq_size);
+  void *ring = ::mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (ring == MAP_FAILED) {
+    LOG_SYSERR << "mmap io_uring rings";
+    return false;
+  }
+  ring_ = ring;
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  void *sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    LOG_SYSERR << "mmap io_uring sqes";
+    return false;
+  }
+  sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+  char *base = static_cast<char *>(ring_);
+  sq_head_ = reinterpret_cast<unsigned *>(base + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned *>(base + params.sq_off.tail);
+  sq_mask_ = *reinterpret_cast<unsigned *>(base + params.sq_off.ring_mask);
+  sq_entries_ = params.sq_entries;
+  cq_head_ = reinterpret_cast<unsigned *>(base + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned *>(base + params.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<unsigned *>(base + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe *>(base + params.cq_off.cqes);
+  // sqes are used in ring order
+  auto *array = reinterpret_cast<unsigned *>(base + params.sq_off.array);
+  for (unsigned i = 0; i < sq_entries_; ++i) {
+    array[i] = i;
+  }
+  return true;
+}
+
+TimeStamp IoUringPoller::poll(int timeoutMs, ChannelList *active_channels) {
+  LOG_TRACE << "fd total count " << numChannels();
+  for (int fd : rearm_) {
+    auto &state = states_[fd];
+    auto channel = channelOf(fd);
+    if (!state.armed && channel != nullptr && !channel->isNoneEvent()) {
+      arm(fd, &state, channel);
+    }
+  }
+  rearm_.clear();
+
+  // completions left from a full cq ring are reaped without waiting
+  bool ready = loadAcquire(cq_tail_) != *cq_head_;
+  int ret = enter(ready ? 0 : 1, timeoutMs);
+  int saved_err = errno;
+  auto now = TimeStamp::now();
+  if (ret < 0 && saved_err != ETIME && saved_err != EINTR &&
+      saved_err != EBUSY) {
+    errno = saved_err;
+    LOG_SYSERR << "IoUringPoller::poll";
+  }
+  fillActiveChannels(active_channels);
+  return now;
+}
+
+void IoUringPoller::fillActiveChannels(ChannelList *active_channels) {
+  size_t first = active_channels->size();
+  unsigned head = *cq_head_;
+  unsigned tail = loadAcquire(cq_tail_);
+  for (; head != tail; ++head) {
+    const auto &cqe = cqes_[head & cq_mask_];
+    if (cqe.user_data == kCancelUserData) {
+      continue;
+    }
+    int fd = static_cast<int>(cqe.user_data & 0xffffffff);
+    auto generation = static_cast<uint32_t>(cqe.user_data >> 32);
+    if (static_cast<size_t>(fd) >= states_.size()) {
+      continue;
+    }
+    auto &state = states_[fd];
+    auto channel = channelOf(fd);
+    if (state.generation != generation || channel == nullptr) {
+      continue;
+    }
+    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+      // the request is finished, one shot or a multishot ended by the kernel
+      state.armed = false;
+      rearm_.push_back(fd);
+    }
+    int revents = cqe.res;
+    if (revents < 0) {
+      if (revents == -ECANCELED) {
+        continue;
+      }
+      LOG_ERROR << "io_uring poll fd = " << fd << ": "
+                << strerror_tl(-revents);
+      revents = POLLERR;
+    }
+    if (state.revents == 0) {
+      active_channels->push_back(channel);
+    }
+    state.revents |= revents;
+  }
+  storeRelease(cq_head_, head);
+
+  for (size_t i = first; i < active_channels->size(); ++i) {
+    auto channel = (*active_channels)[i];
+    auto &state = states_[channel->fd()];
+    channel->setRevents(state.revents);
+    state.revents = 0;
+  }
+  LOG_TRACE << active_channels->size() - first << " events happened";
+}
+
+void IoUringPoller::updateChannel(Channel *channel) {
+  Poller::assertInLoopThread();
+  int fd = channel->fd();
+  LOG_TRACE << "fd = " << fd << " events = " << channel->events()
+            << " index = " << channel->index();
+  if (channel->index() == kNew) {
+    addChannel(channel);
+    channel->setIndex(kAdded);
+  } else {
+    assert(channelOf(fd) == channel);
+  }
+
+  auto &state = stateOf(fd);
+  if (state.armed) {
+    if (state.events == channel->events() &&
+        state.multishot == channel->edgeTriggered()) {
+      return;
+    }
+    disarm(fd, &state);
+  }
+  // a fired one shot request is re-armed here rather than in poll(), with
+  // the events the handler left
+  if (!channel->isNoneEvent()) {
+    arm(fd, &state, channel);
+  }
+}
+
+void IoUringPoller::removeChannel(Channel *channel) {
+  Poller::assertInLoopThread();
+  int fd = channel->fd();
+  LOG_TRACE << "fd = " << fd;
+  assert(channelOf(fd) == channel);
+  assert(channel->isNoneEvent());
+  assert(channel->index() == kAdded);
+  eraseChannel(channel);
+  auto &state = stateOf(fd);
+  if (state.armed) {
+    disarm(fd, &state);
+  }
+  // drop completions already in the cq ring
+  ++state.generation;
+  channel->setIndex(kNew);
+}
+
+IoUringPoller::PollState &IoUringPoller::stateOf(int fd) {
+  if (static_cast<size_t>(fd) >= states_.size()) {
+    states_.resize(std::max<size_t>(fd + 1, states_.size() * 2));
+  }
+  return states_[fd];
+}
+
+void IoUringPoller::arm(int fd, PollState *state, Channel *channel) {
+  auto sqe = getSqe();
+  ++state->generation;
+  state->events = channel->events();
+  state->multishot = channel->edgeTriggered();
+  state->armed = true;
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = static_cast<uint32_t>(state->events);
+  sqe->len = state->multishot ? IORING_POLL_ADD_MULTI : 0;
+  sqe->user_data = userDataOf(fd, state->generation);
+}
+
+void IoUringPoller::disarm(int fd, PollState *state) {
+  auto sqe = getSqe();
+  sqe->opcode = IORING_OP_POLL_REMOVE;
+  sqe->fd = -1;
+  sqe->addr = userDataOf(fd, state->generation);
+  sqe->user_data = kCancelUserData;
+  ++state->generation;
+  state->armed = false;
+}
+
+io_uring_sqe *IoUringPoller::getSqe() {
+  unsigned tail = *sq_tail_;
+  if (tail - loadAcquire(sq_head_) == sq_entries_) {
+    // full, hand the queued requests to the kernel now
+    if (enter(0, 0) < 0) {
+      LOG_SYSFATAL << "IoUringPoller submit";
+    }
+  }
+  // the kernel only reads sqes in io_uring_enter() called by this thread,
+  // so the entry can be published before the caller fills it
+  auto sqe = &sqes_[tail & sq_mask_];
+  memset(sqe, 0, sizeof(*sqe));
+  storeRelease(sq_tail_, tail + 1);
+  return sqe;
+}
+
+int IoUringPoller::enter(unsigned waitNr, int timeoutMs) {
+  unsigned to_submit = *sq_tail_ - loadAcquire(sq_head_);
+  unsigned flags = 0;
+  struct __kernel_timespec ts;
+  struct io_uring_getevents_arg arg;
+  memset(&arg, 0, sizeof(arg));
+  void *argp = nullptr;
+  size_t argsz = 0;
+  if (waitNr > 0) {
+    flags |= IORING_ENTER_GETEVENTS;
+    if (timeoutMs >= 0) {
+      ts.tv_sec = timeoutMs / 1000;
+      ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000 * 1000;
+      arg.sigmask_sz = _NSIG / 8;
+      arg.ts = reinterpret_cast<uint64_t>(&ts);
+      flags |= IORING_ENTER_EXT_ARG;
+      argp = &arg;
+      argsz = sizeof(arg);
+    }
+  } else if (to_submit == 0) {
+    return 0;
+  }
+  return static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd_, to_submit,
+                                    waitNr, flags, argp, argsz));
+}
+
+} // namespace bamboo
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "net/Poller.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct io_uring_cqe;
+struct io_uring_sqe;
+
+namespace bamboo {
+
+// Poller on io_uring poll requests
+// interest changes are queued as submissions and go to the kernel with the
+// io_uring_enter that waits for events, so a poll() is one syscall and
+// there is no epoll_ctl; channels get a one shot request that is re-armed
+// after it fires, which keeps the level triggered behaviour of epoll, edge
+// triggered channels get a multishot request that stays armed
+class IoUringPoller : public Poller {
+public:
+  explicit IoUringPoller(EventLoop *loop);
+
+  ~IoUringPoller() override;
+
+  // false if the kernel lacks io_uring or multishot poll
+  bool valid() const { return ring_fd_ >= 0; }
+
+  TimeStamp poll(int timeoutMs, ChannelList *activeChannels) override;
+
+  void updateChannel(Channel *channel) override;
+
+  void removeChannel(Channel *channel) override;
+
+private:
+  // request of channels_[fd]
+  struct PollState {
+    // bumped whenever a request is armed or cancelled, completions of
+    // older requests are dropped
+    uint32_t generation{0};
+    // of the armed request
+    int events{0};
+    bool armed{false};
+    bool multishot{false};
+    // merged completions of one poll()
+    int revents{0};
+  };
+
+  static const unsigned kEntries = 256;
+
+  bool setup();
+
+  PollState &stateOf(int fd);
+
+  void arm(int fd, PollState *state, Channel *channel);
+
+  void disarm(int fd, PollState *state);
+
+  io_uring_sqe *getSqe();
+
+  // submit queued requests and wait for waitNr completions at most
+  // timeoutMs, a negative timeout waits forever
+  int enter(unsigned waitNr, int timeoutMs);
+
+  void fillActiveChannels(ChannelList *activeChannels);
+
+  int ring_fd_{-1};
+  void *ring_{nullptr};
+  size_t ring_size_{0};
+  io_uring_sqe *sqes_{nullptr};
+  size_t sqes_size_{0};
+
+  // shared with the kernel
+  unsigned *sq_head_{nullptr};
+  unsigned *sq_tail_{nullptr};
+  unsigned *cq_head_{nullptr};
+  unsigned *cq_tail_{nullptr};
+  io_uring_cqe *cqes_{nullptr};
+  unsigned sq_mask_{0};
+  unsigned sq_entries_{0};
+  unsigned cq_mask_{0};
+
+  // indexed by fd
+  std::vector<PollState> states_;
+  // fds whose one shot request fired, re-armed by the next poll()
+  std::vector<int> rearm_;
+};
+
+} // namespace bamboo
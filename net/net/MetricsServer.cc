@@ -0,0 +1,78 @@
+#include "net/MetricsServer.h"
+
+#include "base/Logging.h"
+#include "net/TcpConnection.h"
+
+#include <algorithm>
+
+namespace bamboo {
+
+constexpr size_t MetricsServer::kMaxHeaderSize;
+
+MetricsServer::MetricsServer(EventLoop *loop, const InetAddress &listenAddr,
+                             const Collector &collector)
+    : server_(loop, listenAddr, "MetricsServer"), collector_(collector) {
+  server_.setMessageCallback(
+      std::bind(&MetricsServer::onMessage, this, std::placeholders::_1,
+                std::placeholders::_2, std::placeholders::_3));
+}
+
+void MetricsServer::onMessage(const TcpConnectionPtr &conn, Buffer *buf,
+                              TimeStamp time) {
+  if (!conn->connected()) {
+    // already answered, waiting for the peer to close
+    buf->retrieveAll();
+    return;
+  }
+
+  static const char kHeaderEnd[] = "\r\n\r\n";
+  const char *last = buf->peek() + buf->readableBytes();
+  if (std::search(buf->peek(), last, kHeaderEnd, kHeaderEnd + 4) == last) {
+    if (buf->readableBytes() > kMaxHeaderSize) {
+      reply(conn, "431 Request Header Fields Too Large", "text/plain",
+            "header too large\n");
+    }
+    return;
+  }
+
+  // e.g. "GET /metrics HTTP/1.1"
+  std::string request_line(buf->peek(), buf->findCRLF());
+  buf->retrieveAll();
+  size_t method_end = request_line.find(' ');
+  size_t path_end = request_line.find(' ', method_end + 1);
+  if (method_end == std::string::npos || path_end == std::string::npos) {
+    reply(conn, "400 Bad Request", "text/plain", "bad request\n");
+    return;
+  }
+  std::string method = request_line.substr(0, method_end);
+  std::string path =
+      request_line.substr(method_end + 1, path_end - method_end - 1);
+  size_t query = path.find('?');
+  if (query != std::string::npos) {
+    path.resize(query);
+  }
+
+  if (method != "GET") {
+    reply(conn, "405 Method Not Allowed", "text/plain", "method not allowed\n");
+  } else if (path != "/metrics") {
+    reply(conn, "404 Not Found", "text/plain", "not found\n");
+  } else {
+    reply(conn, "200 OK", "text/plain; version=0.0.4; charset=utf-8",
+          collector_());
+  }
+}
+
+void MetricsServer::reply(const TcpConnectionPtr &conn, const char *status,
+                          const char *contentType, const std::string &body) {
+  std::string response = "HTTP/1.1 ";
+  response += status;
+  response += "\r\nContent-Type: ";
+  response += contentType;
+  response += "\r\nContent-Length: " + std::to_string(body.size()) +
+              "\r\nConnection: close\r\n\r\n";
+  response += body;
+  conn->send(response);
+  conn->shutdown();
+}
+
+} // namespace bamboo
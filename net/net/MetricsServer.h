@@ -0,0 +1,40 @@
+#pragma once
+
+#include "base/Macro.h"
+#include "net/TcpServer.h"
+
+#include <functional>
+#include <string>
+
+namespace bamboo {
+
+// minimal HTTP listener serving GET /metrics for Prometheus
+// every request is answered and the connection closed
+class MetricsServer {
+public:
+  // returns metrics in Prometheus text format, called in the loop thread
+  using Collector = std::function<std::string()>;
+
+  MetricsServer(EventLoop *loop, const InetAddress &listenAddr,
+                const Collector &collector);
+
+  DISALLOW_COPY(MetricsServer)
+
+  void start() { server_.start(); }
+
+  const std::string &ipPort() const { return server_.ipPort(); }
+
+  // requests with larger headers are rejected
+  static constexpr size_t kMaxHeaderSize = 8192;
+
+private:
+  void onMessage(const TcpConnectionPtr &conn, Buffer *buf, TimeStamp time);
+
+  void reply(const TcpConnectionPtr &conn, const char *status,
+             const char *contentType, const std::string &body);
+
+  TcpServer server_;
+  Collector collector_;
+};
+
+} // namespace bamboo
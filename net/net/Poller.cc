@@ -1,8 +1,15 @@
 #include "net/Poller.h"
 
+#include "base/Logging.h"
 #include "net/Channel.h"
 #include "net/EpollPoller.h"
 #include "net/EventLoop.h"
+#include "net/IoUringPoller.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include <algorithm>
 
 namespace bamboo {
 
@@ -12,11 +19,37 @@ Poller::~Poller() = default;
 
 bool Poller::hasChannel(Channel *channel) const {
   assertInLoopThread();
-  auto it = channels_.find(channel->fd());
-  return it != channels_.end() && it->second == channel;
+  return channelOf(channel->fd()) == channel;
+}
+
+uint32_t Poller::addChannel(Channel *channel) {
+  auto fd = static_cast<size_t>(channel->fd());
+  if (fd >= channels_.size()) {
+    channels_.resize(std::max<size_t>(fd + 1, channels_.size() * 2));
+  }
+  auto &slot = channels_[fd];
+  assert(slot.channel == nullptr);
+  slot.channel = channel;
+  ++num_channels_;
+  return ++slot.generation;
+}
+
+void Poller::eraseChannel(Channel *channel) {
+  auto &slot = channels_[channel->fd()];
+  assert(slot.channel == channel);
+  slot.channel = nullptr;
+  --num_channels_;
 }
 
 Poller *Poller::newDefaultPoller(EventLoop *loop) {
+  if (::getenv("BAMBOO_USE_IO_URING")) {
+    auto poller = new IoUringPoller(loop);
+    if (poller->valid()) {
+      return poller;
+    }
+    delete poller;
+    LOG_WARN << "io_uring unavailable, fall back to epoll";
+  }
   return new EpollPoller(loop);
 }
 
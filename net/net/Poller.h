@@ -3,7 +3,9 @@
 #include "base/Macro.h"
 #include "base/TimeStamp.h"
 
-#include <unordered_map>
+#include <stddef.h>
+#include <stdint.h>
+
 #include <vector>
 
 namespace bamboo {
@@ -31,14 +33,36 @@ public:
   bool hasChannel(Channel *channel) const;
 
   // return Poller should RAII
+  // epoll, or io_uring if BAMBOO_USE_IO_URING is set and the kernel has it
   static Poller *newDefaultPoller(EventLoop *loop);
 
   void assertInLoopThread() const;
 
 protected:
-  using ChannelMap = std::unordered_map<int, Channel *>;
+  // channels_[fd], the generation changes whenever the slot gets a new
+  // channel, so an event carrying an older one is stale
+  struct ChannelSlot {
+    Channel *channel{nullptr};
+    uint32_t generation{0};
+  };
+
+  // nullptr if fd is not registered
+  Channel *channelOf(int fd) const {
+    return static_cast<size_t>(fd) < channels_.size() ? channels_[fd].channel
+                                                       : nullptr;
+  }
+
+  uint32_t generationOf(int fd) const { return channels_[fd].generation; }
+
+  // register channel in the slot of its fd, return the new generation
+  uint32_t addChannel(Channel *channel);
+
+  void eraseChannel(Channel *channel);
+
+  size_t numChannels() const { return num_channels_; }
 
-  ChannelMap channels_;
+  std::vector<ChannelSlot> channels_;
+  size_t num_channels_{0};
 
 private:
   EventLoop *loop_;
@@ -0,0 +1,86 @@
+#include "net/ReplicaClient.h"
+
+#include "base/Logging.h"
+#include "controller/Coding.h"
+#include "controller/DatabaseManager.h"
+#include "controller/DumpFile.h"
+#include "controller/Replication.h"
+
+#include <leveldb/write_batch.h>
+
+namespace bamboo {
+
+ReplicaClient::ReplicaClient(EventLoop *loop, const InetAddress &primaryAddr,
+                             DatabaseManager *dbManager)
+    : client_(loop, primaryAddr, "ReplicaClient"), db_manager_(dbManager) {
+  client_.setConnectionCallback(
+      std::bind(&ReplicaClient::onConnection, this, std::placeholders::_1));
+  client_.setMessageCallback(
+      std::bind(&ReplicaClient::onMessage, this, std::placeholders::_1,
+                std::placeholders::_2, std::placeholders::_3));
+  client_.enableRetry();
+}
+
+void ReplicaClient::onConnection(const TcpConnectionPtr &conn) {
+  LOG_INFO << "ReplicaClient - primary " << conn->peerAddress().toIpPort()
+           << " is " << (conn->connected() ? "UP" : "DOWN");
+
+  synced_ = false;
+  std::string().swap(dump_);
+  if (conn->connected()) {
+    conn->send(std::string(replication::kSyncCommand) + "\n");
+  }
+}
+
+void ReplicaClient::onMessage(const TcpConnectionPtr &conn, Buffer *buf,
+                              TimeStamp time) {
+  while (buf->readableBytes() >= replication::kFrameHeaderSize) {
+    const char *frame = buf->peek();
+    size_t len = coding::decodeFixed32(frame);
+    if (buf->readableBytes() < replication::kFrameHeaderSize + len) {
+      break;
+    }
+
+    if (!handleFrame(frame[4], frame + replication::kFrameHeaderSize, len)) {
+      LOG_ERROR << "ReplicaClient - bad frame from primary, resync";
+      conn->forceClose();
+      return;
+    }
+    buf->retrieve(replication::kFrameHeaderSize + len);
+  }
+}
+
+bool ReplicaClient::handleFrame(char type, const char *payload, size_t len) {
+  switch (type) {
+  case replication::kSnapshot:
+    dump_.append(payload, len);
+    return true;
+  case replication::kSnapshotEnd: {
+    DumpReader reader(dump_.data(), dump_.size());
+    if (!reader.valid() || reader.dbIndex() < 0 ||
+        reader.dbIndex() >= DatabaseManager::kNumDatabases) {
+      return false;
+    }
+    bool loaded = db_manager_->loadDump(reader.dbIndex(), &reader);
+    std::string().swap(dump_);
+    return loaded;
+  }
+  case replication::kSyncDone:
+    synced_ = true;
+    LOG_INFO << "ReplicaClient - full sync finished";
+    return true;
+  case replication::kWriteBatch: {
+    int db_index = 0;
+    leveldb::WriteBatch batch;
+    if (!replication::decodeWriteBatch(payload, len, &db_index, &batch)) {
+      return false;
+    }
+    ++applied_batches_;
+    return db_manager_->applyBatch(db_index, &batch);
+  }
+  default:
+    return false;
+  }
+}
+
+} // namespace bamboo
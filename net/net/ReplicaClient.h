@@ -0,0 +1,46 @@
+#pragma once
+
+#include "net/TcpClient.h"
+
+namespace bamboo {
+
+class DatabaseManager;
+
+// replica side of replication
+// connects to the primary, sends SYNC, loads the snapshot and applies the
+// write batches that follow; reconnects and syncs again if connection breaks
+class ReplicaClient {
+public:
+  ReplicaClient(EventLoop *loop, const InetAddress &primaryAddr,
+                DatabaseManager *dbManager);
+
+  DISALLOW_COPY(ReplicaClient)
+
+  void connect() { client_.connect(); }
+
+  // close the connection to the primary without reconnecting, call it and
+  // let the loop run before destroying a connected client
+  void disconnect() { client_.disconnect(); }
+
+  // full sync has finished, data is up to date with the primary
+  bool synced() const { return synced_; }
+
+  uint64_t appliedBatches() const { return applied_batches_; }
+
+private:
+  void onConnection(const TcpConnectionPtr &conn);
+
+  void onMessage(const TcpConnectionPtr &conn, Buffer *buf, TimeStamp time);
+
+  // return false if the frame is malformed
+  bool handleFrame(char type, const char *payload, size_t len);
+
+  TcpClient client_;
+  DatabaseManager *db_manager_;
+  // kSnapshot pieces of the dump being received
+  std::string dump_;
+  bool synced_{false};
+  uint64_t applied_batches_{0};
+};
+
+} // namespace bamboo
@@ -0,0 +1,278 @@
+#include "net/ReplicationSource.h"
+
+#include "base/Logging.h"
+#include "controller/DatabaseManager.h"
+#include "controller/DumpFile.h"
+#include "controller/Replication.h"
+#include "net/EventLoop.h"
+#include "net/TcpConnection.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace bamboo {
+
+namespace {
+// frames a sync thread may queue ahead of the loop
+constexpr size_t kMaxQueuedFrames = 8;
+} // namespace
+
+// frames of a full sync, produced by the sync thread, sent by the loop
+struct ReplicationSource::SyncStream {
+  std::mutex mutex;
+  std::condition_variable not_full;
+  std::deque<std::string> frames;
+  // the last frame is queued
+  bool done{false};
+  // a dump failed, the replica has to sync again
+  bool failed{false};
+  // the replica is gone, the sync thread stops
+  bool cancelled{false};
+  // the loop found no frame, the next one has to resume it
+  bool waiting{false};
+  uint64_t bytes{0};
+
+  void cancel() {
+    std::lock_guard<std::mutex> lck{mutex};
+    cancelled = true;
+    not_full.notify_all();
+  }
+};
+
+ReplicationSource::ReplicationSource(EventLoop *loop,
+                                     DatabaseManager *dbManager)
+    : loop_(loop), db_manager_(dbManager) {
+  db_manager_->setWriteCallback(std::bind(&ReplicationSource::onWrite, this,
+                                          std::placeholders::_1,
+                                          std::placeholders::_2));
+}
+
+ReplicationSource::~ReplicationSource() {
+  db_manager_->setWriteCallback(DatabaseManager::WriteCallback());
+  for (auto &item : replicas_) {
+    if (item.second.stream) {
+      item.second.stream->cancel();
+    }
+  }
+  for (auto &item : sync_threads_) {
+    item.second->join();
+  }
+}
+
+void ReplicationSource::addReplica(const TcpConnectionPtr &conn) {
+  loop_->assertInLoopThread();
+  if (replicas_.count(conn) != 0) {
+    return;
+  }
+  LOG_INFO << "ReplicationSource - replica " << conn->peerAddress().toIpPort()
+           << " starts full sync";
+  // a replica sends nothing after SYNC, it must not be closed as idle
+  conn->leaveIdleWheel();
+  auto &replica = replicas_[conn];
+  replica.stream = std::make_shared<SyncStream>();
+  replica.stream->waiting = true;
+  conn->setWriteCompleteCallback(
+      std::bind(&ReplicationSource::pump, this, std::placeholders::_1));
+
+  // writes applied after this point are in the replica's backlog
+  auto snapshots = db_manager_->takeSnapshots();
+  auto sync_id = next_sync_id_++;
+  std::weak_ptr<TcpConnection> weak_conn(conn);
+  std::unique_ptr<Thread> thread(new Thread(
+      std::bind(&ReplicationSource::streamSnapshots, this, sync_id, weak_conn,
+                replica.stream, snapshots),
+      "ReplSync"));
+  thread->start();
+  sync_threads_[sync_id] = std::move(thread);
+}
+
+void ReplicationSource::removeReplica(const TcpConnectionPtr &conn) {
+  loop_->assertInLoopThread();
+  auto replica = replicas_.find(conn);
+  if (replica == replicas_.end()) {
+    return;
+  }
+  if (replica->second.stream) {
+    replica->second.stream->cancel();
+  }
+  replicas_.erase(replica);
+  LOG_INFO << "ReplicationSource - replica " << conn->peerAddress().toIpPort()
+           << " removed";
+}
+
+void ReplicationSource::onWrite(int dbIndex, const leveldb::WriteBatch &batch) {
+  if (replicas_.empty()) {
+    return;
+  }
+
+  std::string payload;
+  replication::encodeWriteBatch(&payload, dbIndex, batch);
+  std::string frame;
+  frame.reserve(replication::kFrameHeaderSize + payload.size());
+  if (!replication::appendFrame(&frame, replication::kWriteBatch,
+                                payload.data(), payload.size())) {
+    // replicas would miss the batch, they sync again instead
+    LOG_ERROR << "ReplicationSource - write batch of " << payload.size()
+              << " bytes is too large to replicate";
+    for (auto &item : replicas_) {
+      item.first->forceClose();
+    }
+    return;
+  }
+
+  std::vector<TcpConnectionPtr> overflowed;
+  for (auto &item : replicas_) {
+    if (!item.second.syncing) {
+      item.first->send(frame);
+    } else if (backlog_limit_ > 0 &&
+               item.second.backlog.size() + frame.size() > backlog_limit_) {
+      overflowed.push_back(item.first);
+    } else {
+      item.second.backlog += frame;
+    }
+  }
+  // the replica would miss the batch, it syncs again instead
+  for (auto &conn : overflowed) {
+    LOG_WARN << "ReplicationSource - replica "
+             << conn->peerAddress().toIpPort() << " dropped, backlog over "
+             << backlog_limit_ << " bytes during full sync";
+    ++backlog_overflows_;
+    removeReplica(conn);
+    conn->forceClose();
+  }
+}
+
+void ReplicationSource::streamSnapshots(
+    int64_t syncId, const std::weak_ptr<TcpConnection> &weak_conn,
+    const std::shared_ptr<SyncStream> &stream, const SnapshotList &snapshots) {
+  bool ok = true;
+  for (int i = 0; ok && i < DatabaseManager::kNumDatabases; ++i) {
+    // pieces of the dump go out as they are written
+    DumpWriter writer(i, [&](const char *data, size_t len) {
+      while (len > 0) {
+        size_t n = std::min(len, replication::kSnapshotPieceSize);
+        if (!queueFrame(weak_conn, stream.get(), replication::kSnapshot,
+                        data, n)) {
+          return false;
+        }
+        data += n;
+        len -= n;
+      }
+      return true;
+    });
+    ok = db_manager_->dump(i, snapshots[i], &writer) && writer.finish() &&
+         queueFrame(weak_conn, stream.get(), replication::kSnapshotEnd, "",
+                    0);
+  }
+  ok = ok && queueFrame(weak_conn, stream.get(), replication::kSyncDone, "",
+                        0);
+  db_manager_->releaseSnapshots(snapshots);
+
+  bool wake = false;
+  {
+    std::lock_guard<std::mutex> lck{stream->mutex};
+    stream->done = true;
+    stream->failed = !ok;
+    wake = stream->waiting;
+    stream->waiting = false;
+  }
+  if (wake) {
+    loop_->queueInLoop(
+        std::bind(&ReplicationSource::resumeSync, this, weak_conn),
+        EventLoop::kBackground);
+  }
+  loop_->queueInLoop(
+      std::bind(&ReplicationSource::joinSyncThread, this, syncId),
+      EventLoop::kBackground);
+}
+
+bool ReplicationSource::queueFrame(
+    const std::weak_ptr<TcpConnection> &weak_conn, SyncStream *stream,
+    replication::FrameType type, const char *payload, size_t len) {
+  std::string frame;
+  frame.reserve(replication::kFrameHeaderSize + len);
+  replication::appendFrame(&frame, type, payload, len);
+  bool wake = false;
+  {
+    std::unique_lock<std::mutex> lck{stream->mutex};
+    stream->not_full.wait(lck, [stream]() {
+      return stream->cancelled || stream->frames.size() < kMaxQueuedFrames;
+    });
+    if (stream->cancelled) {
+      return false;
+    }
+    stream->bytes += frame.size();
+    stream->frames.push_back(std::move(frame));
+    wake = stream->waiting;
+    stream->waiting = false;
+  }
+  if (wake) {
+    loop_->queueInLoop(
+        std::bind(&ReplicationSource::resumeSync, this, weak_conn),
+        EventLoop::kBackground);
+  }
+  return true;
+}
+
+void ReplicationSource::resumeSync(
+    const std::weak_ptr<TcpConnection> &weak_conn) {
+  auto conn = weak_conn.lock();
+  if (conn) {
+    pump(conn);
+  }
+}
+
+void ReplicationSource::pump(const TcpConnectionPtr &conn) {
+  loop_->assertInLoopThread();
+  auto replica = replicas_.find(conn);
+  if (replica == replicas_.end() || !replica->second.syncing) {
+    return;
+  }
+  auto &stream = *replica->second.stream;
+  std::string frame;
+  bool failed = false;
+  {
+    std::lock_guard<std::mutex> lck{stream.mutex};
+    if (!stream.frames.empty()) {
+      frame.swap(stream.frames.front());
+      stream.frames.pop_front();
+      stream.not_full.notify_one();
+    } else if (!stream.done) {
+      stream.waiting = true;
+      return;
+    }
+    failed = stream.failed;
+  }
+  if (!frame.empty()) {
+    // the write complete callback sends the next one
+    conn->send(frame);
+    return;
+  }
+
+  conn->setWriteCompleteCallback(WriteCompleteCallback());
+  if (failed) {
+    LOG_ERROR << "ReplicationSource - full sync of replica "
+              << conn->peerAddress().toIpPort() << " failed";
+    conn->forceClose();
+    return;
+  }
+  conn->send(replica->second.backlog);
+  replica->second.syncing = false;
+  std::string().swap(replica->second.backlog);
+  LOG_INFO << "ReplicationSource - replica " << conn->peerAddress().toIpPort()
+           << " full sync sent, " << stream.bytes << " bytes";
+  replica->second.stream.reset();
+}
+
+void ReplicationSource::joinSyncThread(int64_t syncId) {
+  loop_->assertInLoopThread();
+  auto thread = sync_threads_.find(syncId);
+  if (thread != sync_threads_.end()) {
+    thread->second->join();
+    sync_threads_.erase(thread);
+  }
+}
+
+} // namespace bamboo
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "base/Macro.h"
+#include "base/Thread.h"
+#include "controller/Replication.h"
+#include "net/CallBack.h"
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace leveldb {
+class Snapshot;
+class WriteBatch;
+}
+
+namespace bamboo {
+
+class DatabaseManager;
+class EventLoop;
+
+// primary side of replication
+// streams a snapshot of every database to each replica, then every applied
+// write batch; a sync thread dumps the snapshot into a short queue of
+// frames and the loop sends the next one whenever the replica's output
+// drains, so neither side holds a whole dump in memory
+// not thread safe, all calls are in the loop thread
+class ReplicationSource {
+public:
+  static constexpr size_t kDefaultBacklogLimit = 64 * 1024 * 1024;
+
+  ReplicationSource(EventLoop *loop, DatabaseManager *dbManager);
+
+  DISALLOW_COPY(ReplicationSource)
+
+  ~ReplicationSource();
+
+  // conn sent SYNC, start full sync
+  void addReplica(const TcpConnectionPtr &conn);
+
+  void removeReplica(const TcpConnectionPtr &conn);
+
+  size_t replicaCount() const { return replicas_.size(); }
+
+  // a replica whose backlog of writes grows past bytes during its full sync
+  // is dropped and syncs again when it reconnects; 0 is no limit
+  void setBacklogLimit(size_t bytes) { backlog_limit_ = bytes; }
+
+  // replicas dropped for their backlog
+  uint64_t backlogOverflows() const { return backlog_overflows_; }
+
+private:
+  struct SyncStream;
+
+  struct Replica {
+    // full sync is running, writes go to backlog
+    bool syncing{true};
+    std::string backlog;
+    std::shared_ptr<SyncStream> stream;
+  };
+
+  void onWrite(int dbIndex, const leveldb::WriteBatch &batch);
+
+  using SnapshotList = std::vector<const leveldb::Snapshot *>;
+
+  // run in sync thread, dump snapshots into frames of stream
+  void streamSnapshots(int64_t syncId,
+                       const std::weak_ptr<TcpConnection> &weak_conn,
+                       const std::shared_ptr<SyncStream> &stream,
+                       const SnapshotList &snapshots);
+
+  // run in sync thread, false if the sync was cancelled
+  bool queueFrame(const std::weak_ptr<TcpConnection> &weak_conn,
+                  SyncStream *stream, replication::FrameType type,
+                  const char *payload, size_t len);
+
+  // send the next frame of a full sync, or finish it
+  void pump(const TcpConnectionPtr &conn);
+
+  void resumeSync(const std::weak_ptr<TcpConnection> &weak_conn);
+
+  void joinSyncThread(int64_t syncId);
+
+  EventLoop *loop_;
+  DatabaseManager *db_manager_;
+  std::unordered_map<TcpConnectionPtr, Replica> replicas_;
+  size_t backlog_limit_{kDefaultBacklogLimit};
+  uint64_t backlog_overflows_{0};
+
+  int64_t next_sync_id_{0};
+  std::map<int64_t, std::unique_ptr<Thread>> sync_threads_;
+};
+
+} // namespace bamboo
@@ -74,4 +74,11 @@ void Socket::setKeepAlive(bool on) {
   ::setsockopt(fd_, SOL_SOCKET, SO_KEEPALIVE, &optval, sizeof optval);
 }
 
+void Socket::setBusyPoll(int micros) {
+  if (::setsockopt(fd_, SOL_SOCKET, SO_BUSY_POLL, &micros, sizeof micros) <
+      0) {
+    LOG_SYSERR << "SO_BUSY_POLL " << micros;
+  }
+}
+
 } // namespace bamboo
\ No newline at end of file
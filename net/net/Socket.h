@@ -42,6 +42,10 @@ public:
   // keep tcp connection alive
   void setKeepAlive(bool on);
 
+  // SO_BUSY_POLL, a blocking read spins on the device queue for micros;
+  // more than net.core.busy_read needs CAP_NET_ADMIN
+  void setBusyPoll(int micros);
+
 private:
   // socket fd
   const int fd_;
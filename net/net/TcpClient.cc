@@ -11,7 +11,8 @@ namespace bamboo {
 namespace detail {
 
 void removeConnnection(EventLoop *loop, const TcpConnectionPtr &conn) {
-  loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+  loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn),
+                    EventLoop::kUrgent);
 }
 
 void removeConnector(const ConnectorPtr &connector) {}
@@ -107,7 +108,8 @@ void TcpClient::removeConnection(const TcpConnectionPtr &conn) {
     connection_.reset();
   }
 
-  loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+  loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn),
+                     EventLoop::kUrgent);
   if (retry_ && connect_) {
     LOG_INFO << "TcpClient::connect [" << name_ << "] - Reconnecting to "
              << connector_->serverAddress().toIpPort();
@@ -3,12 +3,16 @@
 #include "base/Logging.h"
 #include "net/Channel.h"
 #include "net/EventLoop.h"
+#include "net/IdleWheel.h"
+#include "net/InputBudget.h"
 #include "net/Socket.h"
 #include "net/SocketOps.h"
 
 #include <assert.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 namespace bamboo {
 
 static EventLoop *checkLoop(EventLoop *loop) {
@@ -33,14 +37,15 @@ TcpConnection::TcpConnection(EventLoop *loop, const std::string &name,
                              int sockfd, const InetAddress &localAddr,
                              const InetAddress &peerAddr)
     : loop_(checkLoop(loop)), name_(name), state_(kConnecting),
-      socket_(new Socket(sockfd)), channel_(new Channel(loop, sockfd)),
-      local_addr_(localAddr), peer_addr_(peerAddr),
-      high_water_mark_(kHighWaterMark) {
+      reading_(true), socket_(new Socket(sockfd)),
+      channel_(new Channel(loop, sockfd)), local_addr_(localAddr),
+      peer_addr_(peerAddr), high_water_mark_(kHighWaterMark),
+      input_buffer_(0) {
   channel_->setReadCallback(
       std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
   channel_->setWriteCallback(std::bind(&TcpConnection::handleWrite, this));
   channel_->setCloseCallback(std::bind(&TcpConnection::handleClose, this));
-  channel_->setCloseCallback(std::bind(&TcpConnection::handleError, this));
+  channel_->setErrorCallback(std::bind(&TcpConnection::handleError, this));
   LOG_DEBUG << "TcpConnection::ctor[" << name_ << "] at " << this
             << " fd=" << sockfd;
   socket_->setKeepAlive(true);
@@ -50,6 +55,9 @@ TcpConnection::~TcpConnection() {
   LOG_DEBUG << "TcpConnection::dtor[" << name_ << "] at " << this
             << " fd=" << channel_->fd() << " state=" << stateToString();
   assert(state_ == kDisconnected);
+  if (input_budget_) {
+    input_budget_->update(input_charged_, 0);
+  }
 }
 
 void TcpConnection::send(const std::string &buf) {
@@ -59,7 +67,8 @@ void TcpConnection::send(const std::string &buf) {
     } else {
       loop_->runInLoop(std::bind((void(TcpConnection::*)(const std::string &)) &
                                      TcpConnection::sendInLoop,
-                                 this, buf));
+                                 this, buf),
+                       EventLoop::kUrgent);
     }
   }
 }
@@ -72,7 +81,8 @@ void TcpConnection::send(Buffer *buf) {
     } else {
       loop_->runInLoop(std::bind((void(TcpConnection::*)(const std::string &)) &
                                      TcpConnection::sendInLoop,
-                                 this, buf->retrieveAllString()));
+                                 this, buf->retrieveAllString()),
+                       EventLoop::kUrgent);
     }
   }
 }
@@ -89,7 +99,9 @@ void TcpConnection::sendInLoop(const char *message, size_t len) {
     LOG_ERROR << "disconnected, give up writing";
   }
 
-  if (!channel_->isWriting() && output_buffer_.readableBytes() == 0) {
+  // an edge triggered channel is always writing, only the buffer tells
+  // whether earlier data is still queued
+  if (output_buffer_.readableBytes() == 0) {
     wroten_bytes = ::write(channel_->fd(), message, len);
     if (wroten_bytes >= 0) {
       remaining = len - wroten_bytes;
@@ -116,27 +128,157 @@ void TcpConnection::sendInLoop(const char *message, size_t len) {
                             old_len + remaining);
       loop_->queueInLoop([func]() { func(); });
     }
-    output_buffer_.append((char *)message + wroten_bytes, remaining);
+    output_buffer_.append(message + wroten_bytes, remaining);
     if (!channel_->isWriting()) {
       channel_->enableWriting();
     }
+    if (pause_mark_ > 0 && !output_paused_ &&
+        output_buffer_.readableBytes() > pause_mark_) {
+      LOG_DEBUG << "TcpConnection " << name_ << " stops reading, "
+                << output_buffer_.readableBytes() << " bytes to write";
+      output_paused_ = true;
+      updateReading();
+    }
   }
 }
 
 void TcpConnection::shutdown() {
   if (state_ == kConnected) {
     setState(kDisconnecting);
-    loop_->runInLoop(std::bind(&TcpConnection::shutdownInLoop, this));
+    loop_->runInLoop(std::bind(&TcpConnection::shutdownInLoop, this),
+                     EventLoop::kUrgent);
   }
 }
 
 void TcpConnection::forceClose() {
   if (state_ == kConnected || state_ == kDisconnecting) {
     setState(kDisconnecting);
-    loop_->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, this));
+    loop_->queueInLoop(
+        std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()),
+        EventLoop::kUrgent);
+  }
+}
+
+void TcpConnection::setTcpNoDelay(bool on) { socket_->setTcpNoDelay(on); }
+
+void TcpConnection::setBusyPoll(int micros) { socket_->setBusyPoll(micros); }
+
+void TcpConnection::setEdgeTriggered(bool on) {
+  assert(state_ == kConnecting);
+  channel_->setEdgeTriggered(on);
+}
+
+void TcpConnection::setIdleWheel(std::shared_ptr<IdleWheel> wheel) {
+  assert(state_ == kConnecting);
+  idle_wheel_ = std::move(wheel);
+}
+
+void TcpConnection::leaveIdleWheel() {
+  loop_->assertInLoopThread();
+  idle_wheel_.reset();
+  auto entry = idle_entry_.lock();
+  if (entry) {
+    entry->release();
+  }
+  idle_entry_.reset();
+}
+
+void TcpConnection::setBackpressure(size_t high, size_t low) {
+  assert(state_ == kConnecting);
+  assert(low <= high);
+  pause_mark_ = high;
+  resume_mark_ = low;
+}
+
+void TcpConnection::setInputLimits(size_t maxBytes,
+                                   std::shared_ptr<InputBudget> budget,
+                                   const InputLimitCallback &cb) {
+  assert(state_ == kConnecting);
+  input_limit_ = maxBytes;
+  input_budget_ = std::move(budget);
+  input_limit_call_back_ = cb;
+}
+
+void TcpConnection::startRead() {
+  loop_->runInLoop(std::bind(&TcpConnection::startReadInLoop, this));
+}
+
+void TcpConnection::stopRead() {
+  loop_->runInLoop(std::bind(&TcpConnection::stopReadInLoop, this));
+}
+
+void TcpConnection::startReadInLoop() {
+  loop_->assertInLoopThread();
+  bool resumed = !reading_;
+  reading_ = true;
+  updateReading();
+  if (resumed) {
+    deliverBufferedInput();
+  }
+}
+
+void TcpConnection::stopReadInLoop() {
+  loop_->assertInLoopThread();
+  reading_ = false;
+  updateReading();
+}
+
+void TcpConnection::updateReading() {
+  if (state_ != kConnected && state_ != kDisconnecting) {
+    return;
+  }
+  bool want = reading_ && !output_paused_;
+  if (want && !channel_->isReading()) {
+    // an edge triggered channel sees data that arrived while paused, the
+    // interest change makes the poller check readiness again
+    channel_->enableReading();
+  } else if (!want && channel_->isReading()) {
+    channel_->disableReading();
+  }
+}
+
+void TcpConnection::deliverBufferedInput() {
+  if ((state_ == kConnected || state_ == kDisconnecting) && reading_ &&
+      !output_paused_ && input_buffer_.readableBytes() > 0) {
+    message_call_back_(shared_from_this(), &input_buffer_,
+                       loop_->pollReturnTime());
+    checkInputLimits();
   }
 }
 
+void TcpConnection::checkInputLimits() {
+  input_buffer_.reclaim();
+  size_t readable = input_buffer_.readableBytes();
+  bool over = input_limit_ > 0 && readable > input_limit_;
+  if (input_budget_) {
+    size_t capacity = input_buffer_.internalCapacity();
+    input_budget_->update(input_charged_, capacity);
+    input_charged_ = capacity;
+    // only the connections holding more than their share give up their
+    // input, never one that is down to a chunk, e.g. paused by backpressure
+    // with a few requests left
+    over = over ||
+           (input_budget_->exceeded() && readable > 0 &&
+            capacity > std::max(input_budget_->share(), BufferChunk::kSize));
+  }
+  if (!over) {
+    return;
+  }
+  LOG_WARN << "TcpConnection::checkInputLimits [" << name_ << "] - drops "
+           << readable << " bytes of input over the limit";
+  discarding_input_ = true;
+  input_buffer_.retrieveAll();
+  input_buffer_.release();
+  if (input_budget_) {
+    input_budget_->update(input_charged_, input_buffer_.internalCapacity());
+    input_charged_ = input_buffer_.internalCapacity();
+  }
+  if (input_limit_call_back_) {
+    input_limit_call_back_(shared_from_this(), readable);
+  }
+  shutdown();
+}
+
 void TcpConnection::forceCloseInLoop() {
   loop_->assertInLoopThread();
   if (state_ == kConnected || state_ == kDisconnecting) {
@@ -145,7 +287,7 @@ void TcpConnection::forceCloseInLoop() {
 }
 
 void TcpConnection::shutdownInLoop() {
-  if (!channel_->isWriting()) {
+  if (output_buffer_.readableBytes() == 0) {
     socket_->shutdownWrite();
   }
 }
@@ -155,7 +297,15 @@ void TcpConnection::connectEstablished() {
   assert(state_ == kConnecting);
   setState(kConnected);
   channel_->tie(shared_from_this());
-  channel_->enableReading();
+  if (channel_->edgeTriggered()) {
+    channel_->enableWriting();
+  }
+  if (reading_) {
+    channel_->enableReading();
+  }
+  if (idle_wheel_) {
+    idle_wheel_->touch(this);
+  }
   connection_call_back_(shared_from_this());
 }
 
@@ -186,28 +336,75 @@ const char *TcpConnection::stateToString() const {
 }
 
 void TcpConnection::handleRead(TimeStamp receive_time) {
-  int saved_err = 0;
-  auto n = input_buffer_.readFd(channel_->fd(), &saved_err);
-  if (n > 0) {
-    message_call_back_(shared_from_this(), &input_buffer_, receive_time);
-  } else if (n == 0) {
-    handleClose();
-  } else {
-    errno = saved_err;
-    LOG_SYSERR << "read error";
-    handleError();
+  if (idle_wheel_) {
+    idle_wheel_->touch(this);
   }
+  // edge triggered, data left in the socket would not be reported again
+  do {
+    // room for what recent reads brought, so a read lands in the buffer
+    // rather than the loop's scratch
+    input_buffer_.ensureWriteable(read_size_.next());
+    int saved_err = 0;
+    auto n = input_buffer_.readFd(channel_->fd(), &saved_err);
+    if (n > 0) {
+      read_size_.record(n);
+    }
+    if (n > 0 && discarding_input_) {
+      input_buffer_.retrieveAll();
+      input_buffer_.release();
+    } else if (n > 0) {
+      message_call_back_(shared_from_this(), &input_buffer_, receive_time);
+      checkInputLimits();
+    } else if (n == 0) {
+      handleClose();
+      return;
+    } else {
+      if (saved_err == EAGAIN && channel_->edgeTriggered()) {
+        // give back the room made for the read
+        checkInputLimits();
+        return;
+      }
+      errno = saved_err;
+      LOG_SYSERR << "read error";
+      handleError();
+      return;
+    }
+  } while (channel_->edgeTriggered() && channel_->isReading());
 }
 
 void TcpConnection::handleWrite() {
   loop_->assertInLoopThread();
   if (channel_->isWriting()) {
-    auto n = sockets::write(channel_->fd(), output_buffer_.peek(),
-                            output_buffer_.readableBytes());
-    if (n > 0) {
-      output_buffer_.retrieve(n);
+    // EPOLLOUT of an edge triggered channel also comes with read events
+    if (output_buffer_.readableBytes() == 0) {
+      return;
+    }
+    int saved_err = 0;
+    ssize_t n = 0;
+    ssize_t written = 0;
+    // one writev takes a bounded number of chunks, an edge triggered
+    // channel is not told again that the socket is writable, so it writes
+    // until the socket is full
+    do {
+      n = output_buffer_.writeFd(channel_->fd(), &saved_err);
+      written += std::max<ssize_t>(n, 0);
+    } while (n > 0 && channel_->edgeTriggered() &&
+             output_buffer_.readableBytes() > 0);
+    if (written > 0) {
+      // the peer reading replies is activity too, e.g. while it is paused
+      // by backpressure
+      if (idle_wheel_) {
+        idle_wheel_->touch(this);
+      }
+      if (output_paused_ && output_buffer_.readableBytes() <= resume_mark_) {
+        output_paused_ = false;
+        updateReading();
+        deliverBufferedInput();
+      }
       if (output_buffer_.readableBytes() == 0) {
-        channel_->disableWriting();
+        if (!channel_->edgeTriggered()) {
+          channel_->disableWriting();
+        }
         if (write_complete_call_back_) {
           loop_->queueInLoop(
               std::bind(write_complete_call_back_, shared_from_this()));
@@ -216,8 +413,10 @@ void TcpConnection::handleWrite() {
           shutdownInLoop();
         }
       }
-    } else {
-      LOG_ERROR << "write error";
+    }
+    if (n < 0 && saved_err != EWOULDBLOCK) {
+      errno = saved_err;
+      LOG_SYSERR << "write error";
     }
   } else {
     LOG_ERROR << "Tcp Connection fd " << channel_->fd()
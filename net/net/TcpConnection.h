@@ -1,8 +1,10 @@
 #pragma once
 
 #include "base/Macro.h"
+#include "net/AdaptiveReadSize.h"
 #include "net/Buffer.h"
 #include "net/CallBack.h"
+#include "net/ChainBuffer.h"
 #include "net/InetAddress.h"
 
 #include <atomic>
@@ -16,7 +18,10 @@ namespace bamboo {
 class Channel;
 class EventLoop;
 class HttpContext;
+class IdleEntry;
+class IdleWheel;
 class InetAddress;
+class InputBudget;
 class Socket;
 
 class TcpConnection : public std::enable_shared_from_this<TcpConnection> {
@@ -46,6 +51,23 @@ public:
 
   void forceCloseInLoop();
 
+  void setTcpNoDelay(bool on);
+
+  // SO_BUSY_POLL of the socket
+  void setBusyPoll(int micros);
+
+  // read until EAGAIN and keep EPOLLOUT armed instead of toggling it for
+  // every partial write, call before connectEstablished()
+  void setEdgeTriggered(bool on);
+
+  // close the connection when it reads nothing for the timeout of wheel,
+  // call before connectEstablished()
+  void setIdleWheel(std::shared_ptr<IdleWheel> wheel);
+
+  // no longer closed for being idle, e.g. a replication link that only
+  // receives; loop thread only
+  void leaveIdleWheel();
+
   const std::string &name() const { return name_; }
 
   void setConnectionCallback(const ConnectionCallback &cb) {
@@ -65,9 +87,36 @@ public:
   void setHighWaterMarkCallback(const HighWaterMarkCallback &cb,
                                 size_t highWaterMark) {
     high_water_mark_call_back_ = cb;
-    highWaterMark = highWaterMark;
+    high_water_mark_ = highWaterMark;
   }
 
+  // stop reading while more than high bytes wait in the output buffer and
+  // read again once they drain to low, so a client that does not read its
+  // responses cannot grow them without bound; a message callback that sees
+  // backpressured() may leave input in the buffer, it is delivered again
+  // when reading resumes; 0 disables, call before connectEstablished()
+  void setBackpressure(size_t high, size_t low);
+
+  // at most maxBytes of unparsed input, and no more input memory than
+  // budget allows for all connections sharing it, over budget the ones
+  // holding more than an even share are over; past either cb runs, e.g.
+  // to send an error, then the connection shuts down and drops what it
+  // reads until the peer closes; 0 and null disable, call before
+  // connectEstablished()
+  void setInputLimits(size_t maxBytes, std::shared_ptr<InputBudget> budget,
+                      const InputLimitCallback &cb);
+
+  // resume or pause reading the socket, thread safe; reading paused by
+  // backpressure only resumes if startRead() is in effect
+  void startRead();
+
+  void stopRead();
+
+  bool isReading() const { return reading_; }
+
+  // reading is paused until the output buffer drains
+  bool backpressured() const { return output_paused_; }
+
   void connectEstablished();
 
   void connectDestroyed();
@@ -77,6 +126,8 @@ public:
   // HttpContext *getMutableContext() { return context_.get(); }
 
 private:
+  friend class IdleWheel;
+
   enum StateE { kDisconnected = 0, kConnecting, kConnected, kDisconnecting };
 
   void setState(StateE s) { state_ = s; }
@@ -97,11 +148,31 @@ private:
 
   void shutdownInLoop();
 
+  void startReadInLoop();
+
+  void stopReadInLoop();
+
+  // enable reading if it is wanted and not paused by backpressure
+  void updateReading();
+
+  // once reading resumes, pass input the message callback left behind
+  // again, the peer need not send anything more for it to be handled
+  void deliverBufferedInput();
+
+  // after the message callback, give back input memory no longer needed,
+  // charge the budget and give up the input if it is over a limit
+  void checkInputLimits();
+
   EventLoop *loop_;
   
   const std::string name_;
   std::atomic<int> state_;
+  // wanted by startRead()/stopRead()
   bool reading_;
+  // more than pause_mark_ bytes of output, until resume_mark_ is reached
+  bool output_paused_{false};
+  size_t pause_mark_{0};
+  size_t resume_mark_{0};
 
   std::unique_ptr<Socket> socket_;
   std::unique_ptr<Channel> channel_;
@@ -119,8 +190,24 @@ private:
   size_t high_water_mark_;
   CloseCallback close_callback_;
   
+  // storage is borrowed from the ChunkPool only while input is pending
   Buffer input_buffer_;
-  Buffer output_buffer_;
+  AdaptiveReadSize read_size_;
+  // chunks written with writev, queued replies never move
+  ChainBuffer output_buffer_;
+
+  size_t input_limit_{0};
+  std::shared_ptr<InputBudget> input_budget_;
+  // capacity of input_buffer_ charged to input_budget_
+  size_t input_charged_{0};
+  // over a limit, reads are dropped
+  bool discarding_input_{false};
+  InputLimitCallback input_limit_call_back_;
+
+  std::shared_ptr<IdleWheel> idle_wheel_;
+  std::weak_ptr<IdleEntry> idle_entry_;
+  // rotation of idle_wheel_ that last saw a read
+  int64_t idle_rotation_{-1};
 
   // 64M
   static constexpr size_t kHighWaterMark = 64 * 1024 * 1024;
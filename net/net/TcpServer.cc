@@ -4,7 +4,9 @@
 #include "net/Acceptor.h"
 #include "net/EventLoop.h"
 #include "net/EventLoopThreadPool.h"
+#include "net/IdleWheel.h"
 #include "net/InetAddress.h"
+#include "net/InputBudget.h"
 #include "net/TcpConnection.h"
 
 #include <assert.h>
@@ -40,12 +42,36 @@ void TcpServer::setThreadNum(int threads_num) {
 void TcpServer::start() {
   if (started_.exchange(1) == 0) {
     thread_pool_->start(thread_init_callback_);
+    if (idle_timeout_ > 0) {
+      for (auto loop : thread_pool_->getAllLoops()) {
+        auto wheel = std::make_shared<IdleWheel>(loop, idle_timeout_);
+        wheel->start();
+        idle_wheels_.emplace(loop, std::move(wheel));
+      }
+    }
 
     assert(!acceptor_->listening());
     loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
   }
 }
 
+void TcpServer::setInputLimits(size_t perConnection, size_t total) {
+  input_limit_ = perConnection;
+  input_budget_.reset(total > 0 ? new InputBudget(total) : nullptr);
+}
+
+size_t TcpServer::inputBytes() const {
+  return input_budget_ ? input_budget_->used() : 0;
+}
+
+uint64_t TcpServer::idleClosed() const {
+  uint64_t closed = 0;
+  for (const auto &item : idle_wheels_) {
+    closed += item.second->closed();
+  }
+  return closed;
+}
+
 void TcpServer::newConnection(int sockfd, const InetAddress &peer_addr) {
   loop_->assertInLoopThread();
   auto io_loop = thread_pool_->getNextLoop();
@@ -63,14 +89,30 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peer_addr) {
   conn->setConnectionCallback(connection_callback_);
   conn->setMessageCallback(message_callback_);
   conn->setWriteCompleteCallback(write_complete_callback_);
+  conn->setEdgeTriggered(edge_triggered_);
+  if (socket_busy_poll_ > 0) {
+    conn->setBusyPoll(socket_busy_poll_);
+  }
+  if (backpressure_high_ > 0) {
+    conn->setBackpressure(backpressure_high_, backpressure_low_);
+  }
+  if (input_limit_ > 0 || input_budget_) {
+    conn->setInputLimits(input_limit_, input_budget_, input_limit_callback_);
+  }
+  auto wheel = idle_wheels_.find(io_loop);
+  if (wheel != idle_wheels_.end()) {
+    conn->setIdleWheel(wheel->second);
+  }
   conn->setCloseCallback(
       bind(&TcpServer::removeConnection, this, std::placeholders::_1));
-  io_loop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+  io_loop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn),
+                     EventLoop::kUrgent);
 }
 
 void TcpServer::removeConnection(const TcpConnectionPtr &conn) {
   // send cb(remove connection) to main loop
-  loop_->runInLoop(std::bind(&TcpServer::removeConnnectionInLoop, this, conn));
+  loop_->runInLoop(std::bind(&TcpServer::removeConnnectionInLoop, this, conn),
+                   EventLoop::kUrgent);
 }
 
 void TcpServer::removeConnnectionInLoop(const TcpConnectionPtr &conn) {
@@ -81,7 +123,8 @@ void TcpServer::removeConnnectionInLoop(const TcpConnectionPtr &conn) {
     assert(false);
   }
   auto io_loop = conn->getLoop();
-  io_loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+  io_loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn),
+                       EventLoop::kUrgent);
 }
 
 } // namespace bamboo
\ No newline at end of file
@@ -12,7 +12,9 @@ namespace bamboo {
 class Acceptor;
 class EventLoop;
 class EventLoopThreadPool;
+class IdleWheel;
 class InetAddress;
+class InputBudget;
 
 class TcpServer {
 public:
@@ -43,8 +45,46 @@ public:
 
   void setThreadNum(int threads_num);
 
+  // connections drain reads until EAGAIN and keep EPOLLOUT armed, which
+  // saves the epoll_ctl calls of partial writes on busy connections
+  void setEdgeTriggered(bool on) { edge_triggered_ = on; }
+
+  // SO_BUSY_POLL of accepted sockets, 0 leaves the system default
+  void setSocketBusyPoll(int micros) { socket_busy_poll_ = micros; }
+
+  // connections stop reading while more than high bytes of output are
+  // queued and resume at low, see TcpConnection::setBackpressure()
+  void setBackpressure(size_t high, size_t low) {
+    backpressure_high_ = high;
+    backpressure_low_ = low;
+  }
+
+  // connections hold at most perConnection bytes of unparsed input and
+  // all of them together at most total bytes of input buffers, see
+  // TcpConnection::setInputLimits(); 0 disables, call before start()
+  void setInputLimits(size_t perConnection, size_t total);
+
+  void setInputLimitCallback(const InputLimitCallback &cb) {
+    input_limit_callback_ = cb;
+  }
+
+  // memory of input buffers, 0 without a total limit
+  size_t inputBytes() const;
+
+  // close connections that read nothing for seconds, every loop keeps
+  // an IdleWheel rotated by a one second timer, call before start()
+  void setIdleTimeout(int seconds) { idle_timeout_ = seconds; }
+
+  // connections closed by the idle timeout, call after start()
+  uint64_t idleClosed() const;
+
   void start();
 
+  // loops of the pool are created by start()
+  std::shared_ptr<EventLoopThreadPool> threadPool() const {
+    return thread_pool_;
+  }
+
   const std::string &name() const { return name_; }
 
   const std::string &ipPort() const { return ip_port_; }
@@ -67,8 +107,18 @@ private:
   ConnectionCallback connection_callback_;
   MessageCallback message_callback_;
   WriteCompleteCallback write_complete_callback_;
+  InputLimitCallback input_limit_callback_;
   ThreadInitCallback thread_init_callback_;
 
+  bool edge_triggered_{false};
+  int socket_busy_poll_{0};
+  int idle_timeout_{0};
+  size_t backpressure_high_{0};
+  size_t backpressure_low_{0};
+  size_t input_limit_{0};
+  std::shared_ptr<InputBudget> input_budget_;
+  // filled by start()
+  std::unordered_map<EventLoop *, std::shared_ptr<IdleWheel>> idle_wheels_;
   std::atomic<int> started_{0};
   int next_conn_id_{1};
   ConnectionMap connections_;
@@ -2,7 +2,7 @@
 
 namespace bamboo {
 
-int64_t Timer::num_created_ = 0;
+std::atomic<int64_t> Timer::num_created_{0};
 
 void Timer::restart(TimeStamp now) {
   if (repeat_) {
@@ -12,4 +12,18 @@ void Timer::restart(TimeStamp now) {
   }
 }
 
-} // namespace bamboo
\ No newline at end of file
+void Timer::reset(TimerCallback callback, TimeStamp when, double interval) {
+  callback_ = std::move(callback);
+  expiration_ = when;
+  interval_ = interval;
+  repeat_ = interval > 0.0;
+  canceled_ = false;
+  sequece_ = ++num_created_;
+}
+
+void Timer::release() {
+  callback_ = nullptr;
+  sequece_ = 0;
+}
+
+} // namespace bamboo
@@ -3,14 +3,18 @@
 #include "base/TimeStamp.h"
 #include "net/CallBack.h"
 
+#include <atomic>
+
 namespace bamboo {
 
 // timer
+// TimerQueue reuses timers, reset() gives a timer a new sequence so old
+// TimerIds of it are ignored
 class Timer {
 public:
-  Timer(TimerCallback callback, TimeStamp when, double interval)
-      : callback_(callback), expiration_(when), interval_(interval),
-        repeat_(interval > 0.0), sequece_(++num_created_) {}
+  Timer(TimerCallback callback, TimeStamp when, double interval) {
+    reset(std::move(callback), when, interval);
+  }
 
   DISALLOW_COPY(Timer)
 
@@ -26,19 +30,42 @@ public:
   // return sequence number
   int64_t sequece() const { return sequece_; }
 
+  // in a TimerWheel
+  bool scheduled() const { return level_ >= 0; }
+
+  // cancelled while its expiration was being handled
+  bool canceled() const { return canceled_; }
+
+  void cancel() { canceled_ = true; }
+
   void restart(TimeStamp now);
 
+  void reset(TimerCallback callback, TimeStamp when, double interval);
+
+  // drop the callback and what it holds, the timer can be reused
+  void release();
+
   // number of created timers
   static int64_t numCreated() { return num_created_; }
 
 private:
-  const TimerCallback callback_;
+  friend class TimerWheel;
+
+  TimerCallback callback_;
   TimeStamp expiration_;
-  const double interval_;
-  const bool repeat_;
-  const int64_t sequece_;
+  double interval_{0.0};
+  bool repeat_{false};
+  bool canceled_{false};
+  int64_t sequece_{0};
+
+  // position in TimerWheel, level_ is -1 outside of it
+  Timer *prev_{nullptr};
+  Timer *next_{nullptr};
+  int64_t tick_{0};
+  int level_{-1};
+  int slot_{0};
 
-  static int64_t num_created_;
+  static std::atomic<int64_t> num_created_;
 };
 
-} // namespace bamboo
\ No newline at end of file
+} // namespace bamboo
@@ -9,6 +9,8 @@
 #include <sys/timerfd.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 namespace {
 
 // create a timer for time interval, non blocking and close exec
@@ -62,8 +64,11 @@ void resetTimerfd(int timerfd, bamboo::TimeStamp expiration) {
 namespace bamboo {
 
 TimerQueue::TimerQueue(EventLoop *loop)
-    : loop_(loop), timerfd_(createTimefd()), timerfd_channel_(loop, timerfd_) {
+    : loop_(loop), timerfd_(createTimefd()), timerfd_channel_(loop, timerfd_),
+      wheel_(TimerWheel::tickFloor(TimeStamp::now())) {
   timerfd_channel_.setReadCallback(std::bind(&TimerQueue::handleRead, this));
+  // one read resets the expiration count
+  timerfd_channel_.setEdgeTriggered(true);
   timerfd_channel_.enableReading();
 }
 
@@ -71,109 +76,128 @@ TimerQueue::~TimerQueue() {
   timerfd_channel_.disableAll();
   timerfd_channel_.remove();
   ::close(timerfd_);
-  for (const Entry &timer : timers_) {
-    delete timer.second;
+  std::vector<Timer *> timers;
+  wheel_.clear(&timers);
+  for (Timer *timer : timers) {
+    delete timer;
+  }
+  for (Timer *timer : free_timers_) {
+    delete timer;
   }
 }
 
 TimerId TimerQueue::addTimer(TimerCallback cb, TimeStamp when,
                              double interval) {
+  if (loop_->isInLoopThread()) {
+    Timer *timer = newTimer(std::move(cb), when, interval);
+    addTimerInLoop(timer);
+    return {timer, timer->sequece()};
+  }
   // timer will delete in ~TimerQueue()
   auto timer = new Timer(std::move(cb), when, interval);
-  loop_->runInLoop(std::bind(&TimerQueue::addTimerInLoop, this, timer));
-  return {timer, timer->sequece()};
+  TimerId id(timer, timer->sequece());
+  loop_->runInLoop(std::bind(&TimerQueue::addTimerInLoop, this, timer),
+                   EventLoop::kUrgent);
+  return id;
 }
 
 void TimerQueue::cancel(TimerId timerId) {
-  loop_->runInLoop(std::bind(&TimerQueue::cancelInLoop, this, timerId));
+  loop_->runInLoop(std::bind(&TimerQueue::cancelInLoop, this, timerId),
+                   EventLoop::kUrgent);
 }
 
 void TimerQueue::addTimerInLoop(Timer *timer) {
   loop_->assertInLoopThread();
-  bool ret = insert(timer);
-  if (ret) {
-    resetTimerfd(timerfd_, timer->expiration());
+  wheel_.add(timer);
+  if (TimerWheel::tickOf(timer->expiration()) < armed_tick_) {
+    scheduleArm();
   }
 }
 
 void TimerQueue::cancelInLoop(TimerId timerId) {
   loop_->assertInLoopThread();
-  ActiveTimer timer{timerId.timer_, timerId.seq_};
-  auto iter = active_timers_.find(timer);
-  if (iter != active_timers_.end()) {
-    auto n = timers_.erase({iter->first->expiration(), iter->first});
-    delete iter->first;
-    active_timers_.erase(iter);
+  Timer *timer = timerId.timer_;
+  if (timer == nullptr || timer->sequece() != timerId.seq_) {
+    // fired or cancelled before, maybe reused
+    return;
+  }
+  if (timer->scheduled()) {
+    // the timerfd stays set, an early wakeup is cheaper than a syscall
+    wheel_.remove(timer);
+    freeTimer(timer);
   } else if (calling_expired_timers_) {
-    canceling_timers_.insert(timer);
+    // expired in this round, it is neither run nor restarted
+    timer->cancel();
   }
-  assert(timers_.size() == active_timers_.size());
 }
 
 void TimerQueue::handleRead() {
   loop_->assertInLoopThread();
-  TimeStamp now(TimeStamp::now());
+  TimeStamp now(loop_->now());
   readTimerfd(timerfd_, now);
-  std::vector<Entry> expired = getExpired(now);
-
+  armed_tick_ = TimerWheel::kNoTick;
+  wheel_.advance(TimerWheel::tickFloor(now), &expired_);
+  // timers of one tick come in insertion order
+  std::sort(expired_.begin(), expired_.end(), [](Timer *lhs, Timer *rhs) {
+    return lhs->expiration() < rhs->expiration() ||
+           (lhs->expiration() == rhs->expiration() &&
+            lhs->sequece() < rhs->sequece());
+  });
+
+  loop_->stats().onTimerFires(expired_.size());
   calling_expired_timers_ = true;
-  canceling_timers_.clear();
-
-  for (const auto &it : expired) {
-    it.second->run();
+  for (Timer *timer : expired_) {
+    if (!timer->canceled()) {
+      timer->run();
+    }
   }
   calling_expired_timers_ = false;
 
-  reset(expired, now);
-}
-
-std::vector<TimerQueue::Entry> TimerQueue::getExpired(TimeStamp now) {
-  assert(timers_.size() == active_timers_.size());
-  std::vector<Entry> expired;
-  Entry sentry(now, reinterpret_cast<Timer *>(UINTPTR_MAX));
-  auto end = timers_.lower_bound(sentry);
-  std::copy(timers_.begin(), end, back_inserter(expired));
-  timers_.erase(timers_.begin(), end);
-  // erase expired timers from active timers
-  for (const auto &iter : expired) {
-    ActiveTimer timer(iter.second, iter.second->sequece());
-    active_timers_.erase(timer);
-  }
-  return expired;
-}
-
-void TimerQueue::reset(const std::vector<Entry> &expired, TimeStamp now) {
-  TimeStamp next_expire;
-  for (const auto &it : expired) {
-    if (it.second->repeat()) {
-      it.second->restart(now);
-      insert(it.second);
+  for (Timer *timer : expired_) {
+    if (timer->repeat() && !timer->canceled()) {
+      timer->restart(now);
+      wheel_.add(timer);
     } else {
-      delete it.second;
+      freeTimer(timer);
     }
   }
+  expired_.clear();
+  arm();
+}
 
-  if (!timers_.empty()) {
-    next_expire = timers_.begin()->second->expiration();
+void TimerQueue::scheduleArm() {
+  // handleRead() arms after running the timers
+  if (arm_scheduled_ || calling_expired_timers_) {
+    return;
   }
-  if (next_expire.isValid()) {
-    resetTimerfd(timerfd_, next_expire);
+  arm_scheduled_ = true;
+  loop_->queueInLoop(std::bind(&TimerQueue::arm, this), EventLoop::kUrgent);
+}
+
+void TimerQueue::arm() {
+  arm_scheduled_ = false;
+  int64_t next = wheel_.nextTick();
+  if (next >= armed_tick_) {
+    return;
   }
+  armed_tick_ = next;
+  resetTimerfd(timerfd_, TimerWheel::timeOf(next));
 }
 
-bool TimerQueue::insert(Timer *timer) {
-  loop_->assertInLoopThread();
-  assert(timers_.size() == active_timers_.size());
-  bool earliest_changed = false;
-  auto when = timer->expiration();
-  auto iter = timers_.begin();
-  if (iter == timers_.end() || when < iter->first) {
-    earliest_changed = true;
+Timer *TimerQueue::newTimer(TimerCallback cb, TimeStamp when,
+                            double interval) {
+  if (free_timers_.empty()) {
+    return new Timer(std::move(cb), when, interval);
   }
-  timers_.emplace(std::make_pair(when, timer));
-  active_timers_.emplace(std::make_pair(timer, timer->sequece()));
+  Timer *timer = free_timers_.back();
+  free_timers_.pop_back();
+  timer->reset(std::move(cb), when, interval);
+  return timer;
+}
 
-  return earliest_changed;
+void TimerQueue::freeTimer(Timer *timer) {
+  timer->release();
+  free_timers_.push_back(timer);
 }
 
-} // namespace bamboo
\ No newline at end of file
+} // namespace bamboo
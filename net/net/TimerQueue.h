@@ -4,8 +4,8 @@
 #include "base/TimeStamp.h"
 #include "net/CallBack.h"
 #include "net/Channel.h"
+#include "net/TimerWheel.h"
 
-#include <set>
 #include <vector>
 
 namespace bamboo {
@@ -14,6 +14,10 @@ class EventLoop;
 class Timer;
 class TimerId;
 
+// timers of a loop on a TimerWheel and one timerfd
+// timers are recycled through a free list and only deleted with the queue,
+// so checking a stale TimerId is always safe; the timerfd is only set when
+// the next tick of the wheel moves earlier, at most once per loop iteration
 class TimerQueue {
 public:
 explicit TimerQueue(EventLoop *loop);
@@ -26,32 +30,37 @@ TimerId addTimer(TimerCallback cb, TimeStamp when, double interval);
 
 void cancel(TimerId timerId);
 
-private:
-  using Entry = std::pair<TimeStamp, Timer *>;
-  using TimerList = std::set<Entry>;
-  using ActiveTimer = std::pair<Timer *, int64_t>;
-  using ActiveTimerSet = std::set<ActiveTimer>;
+// timers waiting to expire, loop thread only
+size_t size() const { return wheel_.size(); }
 
+private:
   void addTimerInLoop(Timer *timer);
 
   void cancelInLoop(TimerId timerId);
 
   void handleRead();
 
-  std::vector<Entry> getExpired(TimeStamp now);
+  // set the timerfd before the loop polls again
+  void scheduleArm();
 
-  void reset(const std::vector<Entry> &expired, TimeStamp now);
+  // set the timerfd to the next tick of the wheel if that is earlier
+  void arm();
 
-  bool insert(Timer *timer);
+  Timer *newTimer(TimerCallback cb, TimeStamp when, double interval);
+
+  void freeTimer(Timer *timer);
 
   bool calling_expired_timers_{false};
+  bool arm_scheduled_{false};
+  // tick the timerfd is set to
+  int64_t armed_tick_{TimerWheel::kNoTick};
   const int timerfd_;
   EventLoop *loop_;
   Channel timerfd_channel_;
-  TimerList timers_;
-
-  ActiveTimerSet active_timers_;
-  ActiveTimerSet canceling_timers_;
+  TimerWheel wheel_;
+  std::vector<Timer *> expired_;
+  // loop thread only, addTimer() from other threads allocates
+  std::vector<Timer *> free_timers_;
 };
 
-} // namespace bamboo
\ No newline at end of file
+} // namespace bamboo
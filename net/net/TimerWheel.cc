@@ -0,0 +1,194 @@
+#include "net/TimerWheel.h"
+
+#include "net/Timer.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include <algorithm>
+
+namespace bamboo {
+
+constexpr int64_t TimerWheel::kTickMicros;
+constexpr int TimerWheel::kSlotBits;
+constexpr int TimerWheel::kSlots;
+constexpr int TimerWheel::kLevels;
+constexpr int64_t TimerWheel::kNoTick;
+
+TimerWheel::TimerWheel(int64_t currentTick) : current_(currentTick) {
+  memset(occupied_, 0, sizeof(occupied_));
+}
+
+void TimerWheel::add(Timer *timer) {
+  assert(timer->level_ < 0);
+  timer->tick_ = std::max(tickOf(timer->expiration()), current_ + 1);
+  place(timer);
+  ++size_;
+}
+
+void TimerWheel::remove(Timer *timer) {
+  assert(timer->level_ >= 0);
+  auto &slot = slots_[timer->level_][timer->slot_];
+  if (timer->prev_ != nullptr) {
+    timer->prev_->next_ = timer->next_;
+  } else {
+    slot.head = timer->next_;
+  }
+  if (timer->next_ != nullptr) {
+    timer->next_->prev_ = timer->prev_;
+  } else {
+    slot.tail = timer->prev_;
+  }
+  if (slot.head == nullptr) {
+    occupied_[timer->level_][timer->slot_ / 64] &=
+        ~(uint64_t(1) << (timer->slot_ % 64));
+  }
+  timer->prev_ = nullptr;
+  timer->next_ = nullptr;
+  timer->level_ = -1;
+  --size_;
+}
+
+void TimerWheel::advance(int64_t tick, std::vector<Timer *> *expired) {
+  for (;;) {
+    int64_t next = nextTick();
+    if (next > tick) {
+      break;
+    }
+    current_ = next;
+    // a slot of level k comes up when the lower bits are all zero
+    for (int level = 1; level < kLevels; ++level) {
+      if (current_ & ((int64_t(1) << (kSlotBits * level)) - 1)) {
+        break;
+      }
+      cascade(level);
+    }
+    Timer *timer = take(0, static_cast<int>(current_ & (kSlots - 1)));
+    while (timer != nullptr) {
+      Timer *following = timer->next_;
+      timer->prev_ = nullptr;
+      timer->next_ = nullptr;
+      timer->level_ = -1;
+      --size_;
+      expired->push_back(timer);
+      timer = following;
+    }
+  }
+  current_ = std::max(current_, tick);
+}
+
+int64_t TimerWheel::nextTick() const {
+  int64_t next = kNoTick;
+  for (int level = 0; level < kLevels && size_ > 0; ++level) {
+    if (levelEmpty(level)) {
+      continue;
+    }
+    int shift = kSlotBits * level;
+    int index = static_cast<int>((current_ >> shift) & (kSlots - 1));
+    int64_t rotation = current_ >> (shift + kSlotBits) << (shift + kSlotBits);
+    int slot = findSlot(level, index + 1);
+    if (slot < 0) {
+      // the occupied slots belong to the next rotation
+      slot = findSlot(level, 0);
+      rotation += int64_t(1) << (shift + kSlotBits);
+    } else if (level == 0) {
+      // nothing on higher levels comes before the rest of this rotation
+      return rotation + slot;
+    }
+    next = std::min(next, rotation + (int64_t(slot) << shift));
+  }
+  return next;
+}
+
+void TimerWheel::clear(std::vector<Timer *> *timers) {
+  for (int level = 0; level < kLevels; ++level) {
+    for (int slot = 0; slot < kSlots; ++slot) {
+      Timer *timer = take(level, slot);
+      while (timer != nullptr) {
+        Timer *following = timer->next_;
+        timer->prev_ = nullptr;
+        timer->next_ = nullptr;
+        timer->level_ = -1;
+        timers->push_back(timer);
+        timer = following;
+      }
+    }
+  }
+  size_ = 0;
+}
+
+void TimerWheel::place(Timer *timer) {
+  assert(timer->tick_ >= current_);
+  auto delta = static_cast<uint64_t>(timer->tick_ - current_);
+  int level = 0;
+  while (level + 1 < kLevels &&
+         delta >= uint64_t(1) << (kSlotBits * (level + 1))) {
+    ++level;
+  }
+  int64_t tick = timer->tick_;
+  uint64_t range = uint64_t(1) << (kSlotBits * kLevels);
+  if (delta >= range) {
+    // parked as far as the wheel reaches, placed again when it comes up
+    tick = current_ + static_cast<int64_t>(range - 1);
+  }
+  link(timer, level,
+       static_cast<int>((tick >> (kSlotBits * level)) & (kSlots - 1)));
+}
+
+void TimerWheel::link(Timer *timer, int level, int slot) {
+  auto &list = slots_[level][slot];
+  timer->level_ = level;
+  timer->slot_ = slot;
+  timer->prev_ = list.tail;
+  timer->next_ = nullptr;
+  if (list.tail != nullptr) {
+    list.tail->next_ = timer;
+  } else {
+    list.head = timer;
+    occupied_[level][slot / 64] |= uint64_t(1) << (slot % 64);
+  }
+  list.tail = timer;
+}
+
+Timer *TimerWheel::take(int level, int slot) {
+  auto &list = slots_[level][slot];
+  Timer *head = list.head;
+  list.head = nullptr;
+  list.tail = nullptr;
+  occupied_[level][slot / 64] &= ~(uint64_t(1) << (slot % 64));
+  return head;
+}
+
+void TimerWheel::cascade(int level) {
+  int slot = static_cast<int>((current_ >> (kSlotBits * level)) & (kSlots - 1));
+  Timer *timer = take(level, slot);
+  while (timer != nullptr) {
+    Timer *following = timer->next_;
+    place(timer);
+    timer = following;
+  }
+}
+
+int TimerWheel::findSlot(int level, int from) const {
+  for (int word = from / 64; word < kWords; ++word) {
+    uint64_t bits = occupied_[level][word];
+    if (word == from / 64) {
+      bits &= ~uint64_t(0) << (from % 64);
+    }
+    if (bits != 0) {
+      return word * 64 + __builtin_ctzll(bits);
+    }
+  }
+  return -1;
+}
+
+bool TimerWheel::levelEmpty(int level) const {
+  for (int word = 0; word < kWords; ++word) {
+    if (occupied_[level][word] != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace bamboo
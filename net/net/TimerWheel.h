@@ -0,0 +1,99 @@
+#pragma once
+
+#include "base/Macro.h"
+#include "base/TimeStamp.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace bamboo {
+
+class Timer;
+
+// hierarchical timing wheel of kTickMicros ticks
+// level k has kSlots slots of kSlots^k ticks each, a timer sits in the
+// lowest level whose range covers it and moves down a level when the slot
+// holding it comes up; add and remove are O(1), advance only visits ticks
+// that expire or cascade a slot; timers are linked through themselves and
+// not owned
+// not thread safe
+class TimerWheel {
+public:
+  static constexpr int64_t kTickMicros = 1000;
+  static constexpr int kSlotBits = 8;
+  static constexpr int kSlots = 1 << kSlotBits;
+  // 2^32 ticks, ~49 days, farther timers wait in the last level
+  static constexpr int kLevels = 4;
+  static constexpr int64_t kNoTick = INT64_MAX;
+
+  // first tick at or after when, a timer never fires early
+  static int64_t tickOf(TimeStamp when) {
+    return (when.microSecondsSinceEpoch() + kTickMicros - 1) / kTickMicros;
+  }
+
+  // last tick at or before now
+  static int64_t tickFloor(TimeStamp now) {
+    return now.microSecondsSinceEpoch() / kTickMicros;
+  }
+
+  static TimeStamp timeOf(int64_t tick) {
+    return TimeStamp(tick * kTickMicros);
+  }
+
+  explicit TimerWheel(int64_t currentTick);
+
+  DISALLOW_COPY(TimerWheel)
+
+  // at timer->expiration(), a past one fires on the next tick
+  void add(Timer *timer);
+
+  void remove(Timer *timer);
+
+  // move to tick, append timers expired up to it in tick order
+  void advance(int64_t tick, std::vector<Timer *> *expired);
+
+  // earliest tick advance() has work at, a slot to cascade or timers to
+  // expire, kNoTick if empty
+  int64_t nextTick() const;
+
+  // remove all timers into timers
+  void clear(std::vector<Timer *> *timers);
+
+  int64_t currentTick() const { return current_; }
+
+  size_t size() const { return size_; }
+
+  bool empty() const { return size_ == 0; }
+
+private:
+  struct Slot {
+    Timer *head{nullptr};
+    Timer *tail{nullptr};
+  };
+
+  static constexpr int kWords = kSlots / 64;
+
+  // link timer at its tick, delta 0 is allowed while cascading
+  void place(Timer *timer);
+
+  void link(Timer *timer, int level, int slot);
+
+  // detach all timers of a slot, linked through Timer::next_
+  Timer *take(int level, int slot);
+
+  void cascade(int level);
+
+  // first occupied slot at or after from, -1 if none
+  int findSlot(int level, int from) const;
+
+  bool levelEmpty(int level) const;
+
+  int64_t current_;
+  size_t size_{0};
+  Slot slots_[kLevels][kSlots];
+  uint64_t occupied_[kLevels][kWords];
+};
+
+} // namespace bamboo
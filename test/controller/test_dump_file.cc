@@ -0,0 +1,107 @@
+#include "controller/DumpFile.h"
+
+#include "controller/DatabaseManager.h"
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+using namespace bamboo;
+
+namespace {
+
+std::string makeDump(int dbIndex, int count) {
+  std::string out;
+  DumpWriter writer(dbIndex, [&out](const char *data, size_t len) {
+    out.append(data, len);
+    return true;
+  });
+  for (int i = 0; i < count; ++i) {
+    auto key = "key" + std::to_string(i);
+    auto value = std::string(i % 300, 'v');
+    EXPECT_TRUE(writer.add(key.data(), key.size(), value.data(), value.size()));
+  }
+  EXPECT_TRUE(writer.finish());
+  EXPECT_EQ(writer.bytesWritten(), out.size());
+  return out;
+}
+
+std::string tempDir() {
+  char dir[] = "/tmp/test_dump_file.XXXXXX";
+  return ::mkdtemp(dir);
+}
+
+void writeFile(const std::string &path, const std::string &data) {
+  FILE *fp = ::fopen(path.c_str(), "w");
+  ASSERT_NE(nullptr, fp);
+  ASSERT_EQ(data.size(), ::fwrite(data.data(), 1, data.size(), fp));
+  ::fclose(fp);
+}
+
+} // namespace
+
+TEST(dump_file_test, round_trip) {
+  auto dump = makeDump(3, 5000);
+  DumpReader reader(dump.data(), dump.size());
+  ASSERT_TRUE(reader.valid()) << reader.error();
+  EXPECT_EQ(3, reader.dbIndex());
+  EXPECT_EQ(5000, reader.count());
+
+  const char *key;
+  const char *value;
+  size_t key_len;
+  size_t value_len;
+  int n = 0;
+  while (reader.next(&key, &key_len, &value, &value_len)) {
+    EXPECT_EQ("key" + std::to_string(n), std::string(key, key_len));
+    EXPECT_EQ(static_cast<size_t>(n % 300), value_len);
+    ++n;
+  }
+  EXPECT_TRUE(reader.valid());
+  EXPECT_EQ(5000, n);
+}
+
+TEST(dump_file_test, empty_database) {
+  auto dump = makeDump(0, 0);
+  DumpReader reader(dump.data(), dump.size());
+  ASSERT_TRUE(reader.valid());
+  const char *key;
+  const char *value;
+  size_t key_len;
+  size_t value_len;
+  EXPECT_FALSE(reader.next(&key, &key_len, &value, &value_len));
+}
+
+TEST(dump_file_test, detect_corruption) {
+  auto dump = makeDump(1, 100);
+  dump[dump.size() / 2] ^= 0x01;
+  DumpReader reader(dump.data(), dump.size());
+  EXPECT_FALSE(reader.valid());
+
+  auto truncated = makeDump(1, 100);
+  truncated.resize(truncated.size() - 1);
+  DumpReader reader2(truncated.data(), truncated.size());
+  EXPECT_FALSE(reader2.valid());
+}
+
+// a dump is only loaded into the database it was taken from
+TEST(dump_file_test, load_dump_of_another_database) {
+  auto dir = tempDir();
+  DatabaseManager db_manager(dir + "/db");
+  db_manager.setDumpDirectory(dir);
+  writeFile(dir + "/db0.dump", makeDump(3, 5));
+  writeFile(dir + "/db3.dump", makeDump(3, 5));
+
+  EXPECT_FALSE(db_manager.loadDump(0, dir + "/db0.dump"));
+  db_manager.loadDumps();
+  EXPECT_EQ("EMPTY DATABASE", db_manager.listAllKVs(0));
+  EXPECT_NE(std::string::npos, db_manager.listAllKVs(3).find("key4: "));
+}
+
+int main() {
+  testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,52 @@
+#include "controller/HotKeys.h"
+
+#include "gtest/gtest.h"
+
+#include <string>
+
+using namespace bamboo;
+
+TEST(hot_keys_test, finds_skewed_keys) {
+  HotKeys hot_keys(2, 1);
+  // three hot keys among many cold ones
+  for (int i = 0; i < 20000; ++i) {
+    hot_keys.touch(0, "cold" + std::to_string(i));
+    if (i % 2 == 0) {
+      hot_keys.touch(0, "hot1");
+    }
+    if (i % 4 == 0) {
+      hot_keys.touch(0, "hot2");
+    }
+    if (i % 8 == 0) {
+      hot_keys.touch(0, "hot3");
+    }
+  }
+
+  auto top = hot_keys.top(0, 3);
+  ASSERT_EQ(3u, top.size());
+  EXPECT_EQ("hot1", top[0].first);
+  EXPECT_EQ("hot2", top[1].first);
+  EXPECT_EQ("hot3", top[2].first);
+  // count-min never underestimates
+  EXPECT_GE(top[0].second, 10000u);
+  EXPECT_LT(top[0].second, 12000u);
+
+  // databases are counted separately
+  EXPECT_TRUE(hot_keys.top(1, 3).empty());
+}
+
+TEST(hot_keys_test, sampling) {
+  HotKeys hot_keys(1, 16);
+  for (int i = 0; i < 16000; ++i) {
+    hot_keys.touch(0, "key");
+  }
+  auto top = hot_keys.top(0, 10);
+  ASSERT_EQ(1u, top.size());
+  EXPECT_EQ("key", top[0].first);
+  EXPECT_NEAR(16000, top[0].second, 16000 * 0.2);
+}
+
+int main() {
+  testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
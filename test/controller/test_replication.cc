@@ -0,0 +1,266 @@
+#include "controller/Replication.h"
+
+#include "controller/Coding.h"
+#include "controller/DatabaseManager.h"
+#include "net/EventLoop.h"
+#include "net/ReplicaClient.h"
+#include "net/ReplicationSource.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include "gtest/gtest.h"
+
+#include <leveldb/write_batch.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+using namespace bamboo;
+
+namespace {
+
+// operations of a batch as "put key value" and "del key"
+class BatchRecorder : public leveldb::WriteBatch::Handler {
+public:
+  void Put(const leveldb::Slice &key, const leveldb::Slice &value) override {
+    ops.push_back("put " + key.ToString() + " " + value.ToString());
+  }
+
+  void Delete(const leveldb::Slice &key) override {
+    ops.push_back("del " + key.ToString());
+  }
+
+  std::vector<std::string> ops;
+};
+
+std::string tempDir() {
+  char dir[] = "/tmp/test_replication.XXXXXX";
+  return ::mkdtemp(dir);
+}
+
+} // namespace
+
+TEST(replication_test, write_batch_round_trip) {
+  leveldb::WriteBatch batch;
+  batch.Put("k1", "v1");
+  batch.Delete("k2");
+  batch.Put("k3", std::string(1000, 'x'));
+  std::string payload;
+  replication::encodeWriteBatch(&payload, 7, batch);
+
+  int db_index = -1;
+  leveldb::WriteBatch decoded;
+  ASSERT_TRUE(replication::decodeWriteBatch(payload.data(), payload.size(),
+                                            &db_index, &decoded));
+  EXPECT_EQ(7, db_index);
+  BatchRecorder recorder;
+  decoded.Iterate(&recorder);
+  EXPECT_EQ((std::vector<std::string>{"put k1 v1", "del k2",
+                                      "put k3 " + std::string(1000, 'x')}),
+            recorder.ops);
+
+  // a truncated payload is rejected
+  leveldb::WriteBatch truncated;
+  EXPECT_FALSE(replication::decodeWriteBatch(
+      payload.data(), payload.size() - 1, &db_index, &truncated));
+}
+
+TEST(replication_test, frames) {
+  std::string stream;
+  ASSERT_TRUE(replication::appendFrame(&stream, replication::kSnapshot,
+                                       "dump", 4));
+  ASSERT_TRUE(
+      replication::appendFrame(&stream, replication::kSyncDone, "", 0));
+  ASSERT_EQ(2 * replication::kFrameHeaderSize + 4, stream.size());
+
+  EXPECT_EQ(4u, coding::decodeFixed32(stream.data()));
+  EXPECT_EQ(replication::kSnapshot, stream[4]);
+  EXPECT_EQ("dump", stream.substr(replication::kFrameHeaderSize, 4));
+  const char *next = stream.data() + replication::kFrameHeaderSize + 4;
+  EXPECT_EQ(0u, coding::decodeFixed32(next));
+  EXPECT_EQ(replication::kSyncDone, next[4]);
+
+  // the length would not fit the header, nothing is appended
+  EXPECT_FALSE(replication::appendFrame(&stream, replication::kSnapshot,
+                                        stream.data(),
+                                        replication::kMaxFrameLength + 1));
+  EXPECT_EQ(2 * replication::kFrameHeaderSize + 4, stream.size());
+}
+
+TEST(replication_test, sync_over_loopback) {
+  DatabaseManager primary_db(tempDir());
+  DatabaseManager replica_db(tempDir());
+  // larger than a snapshot piece, so a dump spans several frames
+  std::string big(3 * replication::kSnapshotPieceSize + 100, 'b');
+  primary_db.set(0, "a", "1");
+  primary_db.set(3, "big", big);
+  for (int i = 0; i < 1000; ++i) {
+    primary_db.set(5, "key" + std::to_string(i), std::to_string(i));
+  }
+
+  EventLoop loop;
+  InetAddress addr(19301);
+  TcpServer server(&loop, addr, "Primary");
+  ReplicationSource source(&loop, &primary_db);
+  server.setConnectionCallback([&source](const TcpConnectionPtr &conn) {
+    if (!conn->connected()) {
+      source.removeReplica(conn);
+    }
+  });
+  server.setMessageCallback(
+      [&](const TcpConnectionPtr &conn, Buffer *buf, TimeStamp) {
+        buf->retrieveAll();
+        source.addReplica(conn);
+        // written during the full sync, sent from the backlog
+        primary_db.set(1, "during", "x");
+      });
+  server.start();
+
+  ReplicaClient replica(&loop, addr, &replica_db);
+  replica.connect();
+  bool wrote_after = false;
+  TimerId check = loop.runEvery(0.01, [&]() {
+    if (!replica.synced()) {
+      return;
+    }
+    if (!wrote_after) {
+      wrote_after = true;
+      primary_db.set(0, "after", "y");
+    } else if (replica.appliedBatches() >= 2) {
+      loop.quit();
+    }
+  });
+  TimerId timeout = loop.runAfter(10.0, [&loop]() { loop.quit(); });
+  loop.loop();
+  loop.cancel(check);
+  loop.cancel(timeout);
+
+  ASSERT_TRUE(replica.synced());
+  EXPECT_EQ(2u, replica.appliedBatches());
+  EXPECT_EQ("1", replica_db.get(0, "a"));
+  EXPECT_EQ(big, replica_db.get(3, "big"));
+  EXPECT_EQ("999", replica_db.get(5, "key999"));
+  EXPECT_EQ("x", replica_db.get(1, "during"));
+  EXPECT_EQ("y", replica_db.get(0, "after"));
+  EXPECT_EQ(1u, source.replicaCount());
+
+  // the primary drops the replica once the connection closes
+  replica.disconnect();
+  loop.runEvery(0.01, [&]() {
+    if (source.replicaCount() == 0) {
+      loop.quit();
+    }
+  });
+  loop.runAfter(10.0, [&loop]() { loop.quit(); });
+  loop.loop();
+  EXPECT_EQ(0u, source.replicaCount());
+}
+
+TEST(replication_test, replica_outlives_idle_timeout) {
+  DatabaseManager primary_db(tempDir());
+  DatabaseManager replica_db(tempDir());
+  primary_db.set(0, "a", "1");
+
+  EventLoop loop;
+  InetAddress addr(19302);
+  TcpServer server(&loop, addr, "Primary");
+  // like Server -i 1
+  server.setIdleTimeout(1);
+  ReplicationSource source(&loop, &primary_db);
+  server.setConnectionCallback([&source](const TcpConnectionPtr &conn) {
+    if (!conn->connected()) {
+      source.removeReplica(conn);
+    }
+  });
+  server.setMessageCallback(
+      [&source](const TcpConnectionPtr &conn, Buffer *buf, TimeStamp) {
+        buf->retrieveAll();
+        source.addReplica(conn);
+      });
+  server.start();
+
+  ReplicaClient replica(&loop, addr, &replica_db);
+  replica.connect();
+  // the replica sends nothing after SYNC for more than two rotations
+  loop.runAfter(2.5, [&loop]() { loop.quit(); });
+  loop.loop();
+
+  EXPECT_TRUE(replica.synced());
+  EXPECT_EQ("1", replica_db.get(0, "a"));
+  EXPECT_EQ(1u, source.replicaCount());
+  EXPECT_EQ(0u, server.idleClosed());
+
+  replica.disconnect();
+  loop.runEvery(0.01, [&]() {
+    if (source.replicaCount() == 0) {
+      loop.quit();
+    }
+  });
+  loop.runAfter(10.0, [&loop]() { loop.quit(); });
+  loop.loop();
+}
+
+// a replica whose backlog outgrows the limit during full sync is dropped
+// and syncs again
+TEST(replication_test, backlog_over_limit_drops_the_replica) {
+  DatabaseManager primary_db(tempDir());
+  DatabaseManager replica_db(tempDir());
+  primary_db.set(0, "a", "1");
+  const std::string big(4096, 'b');
+
+  EventLoop loop;
+  InetAddress addr(19303);
+  TcpServer server(&loop, addr, "Primary");
+  ReplicationSource source(&loop, &primary_db);
+  source.setBacklogLimit(1024);
+  server.setConnectionCallback([&source](const TcpConnectionPtr &conn) {
+    if (!conn->connected()) {
+      source.removeReplica(conn);
+    }
+  });
+  bool wrote_during = false;
+  server.setMessageCallback(
+      [&](const TcpConnectionPtr &conn, Buffer *buf, TimeStamp) {
+        buf->retrieveAll();
+        source.addReplica(conn);
+        // only the first sync gets a write over the limit
+        if (!wrote_during) {
+          wrote_during = true;
+          primary_db.set(1, "during", big);
+        }
+      });
+  server.start();
+
+  ReplicaClient replica(&loop, addr, &replica_db);
+  replica.connect();
+  TimerId check = loop.runEvery(0.01, [&]() {
+    if (replica.synced()) {
+      loop.quit();
+    }
+  });
+  TimerId timeout = loop.runAfter(10.0, [&loop]() { loop.quit(); });
+  loop.loop();
+  loop.cancel(check);
+  loop.cancel(timeout);
+
+  ASSERT_TRUE(replica.synced());
+  EXPECT_EQ(1u, source.backlogOverflows());
+  EXPECT_EQ(1u, source.replicaCount());
+  // the second sync has it in the snapshot
+  EXPECT_EQ(big, replica_db.get(1, "during"));
+
+  replica.disconnect();
+  loop.runEvery(0.01, [&]() {
+    if (source.replicaCount() == 0) {
+      loop.quit();
+    }
+  });
+  loop.runAfter(10.0, [&loop]() { loop.quit(); });
+  loop.loop();
+}
+
+int main() {
+  testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
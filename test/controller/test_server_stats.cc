@@ -0,0 +1,48 @@
+#include "controller/ServerStats.h"
+
+#include "gtest/gtest.h"
+
+using namespace bamboo;
+
+TEST(server_stats_test, command_names) {
+  EXPECT_EQ(kCmdGet, commandOf("GET"));
+  EXPECT_EQ(kCmdBgsave, commandOf("BGSAVE"));
+  EXPECT_EQ(kCmdUnknown, commandOf("get"));
+  EXPECT_EQ(kCmdUnknown, commandOf(""));
+  for (int i = 0; i < kNumCommands; ++i) {
+    EXPECT_NE(nullptr, commandName(static_cast<Command>(i)));
+  }
+  EXPECT_STREQ("currentdb", commandName(kCmdCurrentDb));
+}
+
+TEST(server_stats_test, ops_per_second) {
+  ServerStats stats;
+  for (int i = 0; i < 5; ++i) {
+    stats.onCommand(kCmdGet);
+  }
+  stats.onCommand(kCmdSet);
+  stats.sample();
+  EXPECT_EQ(5u, stats.opsPerSecond(kCmdGet));
+  EXPECT_EQ(1u, stats.opsPerSecond(kCmdSet));
+
+  stats.onCommand(kCmdGet);
+  stats.sample();
+  EXPECT_EQ(1u, stats.opsPerSecond(kCmdGet));
+  EXPECT_EQ(0u, stats.opsPerSecond(kCmdSet));
+  EXPECT_EQ(6u, stats.calls(kCmdGet));
+  EXPECT_EQ(7u, stats.totalCalls());
+}
+
+TEST(server_stats_test, connections) {
+  ServerStats stats;
+  stats.onConnection(true);
+  stats.onConnection(true);
+  stats.onConnection(false);
+  EXPECT_EQ(1, stats.connectedClients());
+  EXPECT_EQ(2u, stats.totalConnections());
+}
+
+int main() {
+  testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,83 @@
+#include "controller/SlowLog.h"
+
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <vector>
+
+using namespace bamboo;
+
+TEST(slow_log_test, threshold) {
+  SlowLog log;
+  log.setThreshold(100);
+  EXPECT_FALSE(log.slow(99));
+  EXPECT_TRUE(log.slow(100));
+  log.setThreshold(-1);
+  EXPECT_FALSE(log.slow(1000000));
+}
+
+TEST(slow_log_test, newest_first_and_bounded) {
+  SlowLog log(4);
+  for (int i = 0; i < 6; ++i) {
+    log.add(1000 + i, 200 + i, i, "GET k" + std::to_string(i),
+            "127.0.0.1:5000");
+  }
+  EXPECT_EQ(4u, log.size());
+
+  auto entries = log.get(10);
+  ASSERT_EQ(4u, entries.size());
+  EXPECT_EQ(5u, entries[0].id);
+  EXPECT_EQ("GET k5", entries[0].command);
+  EXPECT_EQ(205, entries[0].duration);
+  EXPECT_EQ(5, entries[0].db_index);
+  EXPECT_EQ("127.0.0.1:5000", entries[0].client);
+  EXPECT_EQ(2u, entries[3].id);
+
+  EXPECT_EQ(2u, log.get(2).size());
+
+  log.reset();
+  EXPECT_EQ(0u, log.size());
+  EXPECT_TRUE(log.get(10).empty());
+  log.add(0, 1, 0, "SET a b", "c");
+  EXPECT_EQ(1u, log.get(10).size());
+}
+
+TEST(slow_log_test, truncate_command) {
+  SlowLog log;
+  std::string command = "SET k " + std::string(500, 'v');
+  log.add(0, 1, 0, command, "client");
+  auto entries = log.get(1);
+  ASSERT_EQ(1u, entries.size());
+  EXPECT_EQ(command.substr(0, SlowLog::kMaxCommandLength) + "... (" +
+                std::to_string(command.size() - SlowLog::kMaxCommandLength) +
+                " more bytes)",
+            entries[0].command);
+}
+
+TEST(slow_log_test, concurrent_add) {
+  SlowLog log(16);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&log, t]() {
+      for (int i = 0; i < 10000; ++i) {
+        log.add(i, t, t, std::string(40, static_cast<char>('a' + t)), "c");
+      }
+    });
+  }
+  for (int i = 0; i < 1000; ++i) {
+    for (const auto &entry : log.get(16)) {
+      // an entry is never torn
+      ASSERT_EQ(std::string(40, static_cast<char>('a' + entry.duration)),
+                entry.command);
+    }
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(16u, log.size());
+}
+
+int main() {
+  testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
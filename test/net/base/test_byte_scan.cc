@@ -0,0 +1,40 @@
+#include "base/ByteScan.h"
+
+#include "gtest/gtest.h"
+
+#include <string.h>
+
+#include <string>
+
+using namespace bamboo;
+
+TEST(byte_scan_test, find_matches_memchr) {
+    std::string text(200, 'a');
+    // every length and position, across vector widths and tails
+    for (size_t len = 0; len <= text.size(); ++len) {
+        for (size_t pos = 0; pos <= len; ++pos) {
+            std::string s = text.substr(0, len);
+            if (pos < len) {
+                s[pos] = '\n';
+            }
+            const char *want = static_cast<const char *>(
+                memchr(s.data(), '\n', s.size()));
+            EXPECT_EQ(ByteScan::find(s.data(), s.data() + s.size(), '\n'),
+                      want);
+        }
+    }
+}
+
+TEST(byte_scan_test, find_crlf) {
+    std::string s = "GET a\rb\nc\r\n";
+    const char *crlf = ByteScan::findCRLF(s.data(), s.data() + s.size());
+    EXPECT_EQ(crlf, s.data() + s.size() - 2);
+    EXPECT_EQ(ByteScan::findCRLF(s.data(), s.data() + s.size() - 1),
+              nullptr);
+    EXPECT_NE(std::string(ByteScan::implementation()), "");
+}
+
+int main() {
+    testing::InitGoogleTest();
+    return RUN_ALL_TESTS();
+}
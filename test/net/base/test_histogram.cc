@@ -0,0 +1,78 @@
+#include "base/Histogram.h"
+
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <vector>
+
+using namespace bamboo;
+
+TEST(histogram_test, buckets) {
+  for (int i = 0; i < Histogram::kNumBuckets; ++i) {
+    uint64_t lower = Histogram::lowerBound(i);
+    uint64_t upper = Histogram::upperBound(i);
+    ASSERT_LE(lower, upper);
+    EXPECT_EQ(i, Histogram::bucketOf(lower));
+    EXPECT_EQ(i, Histogram::bucketOf(upper));
+    // relative width of a bucket stays small
+    EXPECT_LE((upper - lower) * 32, lower + 32);
+  }
+  EXPECT_EQ(Histogram::kNumBuckets - 1,
+            Histogram::bucketOf(Histogram::kMaxValue + 12345));
+}
+
+TEST(histogram_test, percentiles) {
+  Histogram h;
+  EXPECT_EQ(0u, h.percentile(99));
+  for (uint64_t v = 1; v <= 10000; ++v) {
+    h.record(v);
+  }
+  EXPECT_EQ(10000u, h.count());
+  EXPECT_EQ(10000u, h.max());
+  EXPECT_NEAR(5000.5, h.mean(), 0.01);
+  EXPECT_NEAR(5000, h.percentile(50), 5000 * 0.04);
+  EXPECT_NEAR(9900, h.percentile(99), 9900 * 0.04);
+  EXPECT_NEAR(9990, h.percentile(99.9), 9990 * 0.04);
+  EXPECT_EQ(10000u, h.percentile(100));
+
+  EXPECT_EQ(63u, h.countAtOrBelow(63));
+  EXPECT_NEAR(1000, h.countAtOrBelow(1000), 1000 * 0.04);
+  EXPECT_EQ(10000u, h.countAtOrBelow(Histogram::kMaxValue));
+
+  // a value inside a bucket counts the whole bucket, its upper edge is exact
+  uint64_t edge = Histogram::upperBound(Histogram::bucketOf(1000));
+  EXPECT_GT(edge, 1000u);
+  EXPECT_EQ(edge, h.countAtOrBelow(1000));
+  EXPECT_EQ(edge, h.countAtOrBelow(edge));
+}
+
+TEST(histogram_test, sharded_merge) {
+  ShardedHistograms histograms(2);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&histograms, t]() {
+      for (int i = 0; i < 1000; ++i) {
+        histograms.record(0, 100);
+        histograms.record(1, 1000 * (t + 1));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  auto h0 = histograms.merged(0);
+  EXPECT_EQ(4000u, h0.count());
+  EXPECT_EQ(400000u, h0.sum());
+  EXPECT_EQ(100u, h0.max());
+
+  auto h1 = histograms.merged(1);
+  EXPECT_EQ(4000u, h1.count());
+  EXPECT_EQ(4000u, h1.max());
+  EXPECT_NEAR(4000, h1.percentile(99), 4000 * 0.04);
+}
+
+int main() {
+  testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
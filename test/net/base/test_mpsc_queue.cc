@@ -0,0 +1,145 @@
+#include "base/MpscQueue.h"
+
+#include "base/Task.h"
+
+#include "gtest/gtest.h"
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+using namespace bamboo;
+
+namespace {
+std::atomic<size_t> g_allocations{0};
+} // namespace
+
+// count every allocation of the test binary
+void *operator new(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  void *p = ::malloc(size == 0 ? 1 : size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+// not inlined, so the compiler does not pair malloc above with a delete
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+  ::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept { ::operator delete(p); }
+
+TEST(mpsc_queue_test, fifo) {
+  MpscQueue<int> queue;
+  int value;
+  EXPECT_FALSE(queue.pop(&value));
+  for (int i = 0; i < 10; ++i) {
+    queue.push(i);
+  }
+  EXPECT_EQ(10u, queue.size());
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(queue.pop(&value));
+    EXPECT_EQ(i, value);
+  }
+  EXPECT_FALSE(queue.pop(&value));
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(mpsc_queue_test, consume_leaves_new_items) {
+  MpscQueue<int> queue;
+  queue.push(1);
+  queue.push(2);
+  std::vector<int> seen;
+  size_t n = queue.consume([&queue, &seen](int v) {
+    seen.push_back(v);
+    // pushed while consuming, left for the next round
+    queue.push(v + 10);
+  });
+  EXPECT_EQ(2u, n);
+  EXPECT_EQ((std::vector<int>{1, 2}), seen);
+  EXPECT_EQ(2u, queue.size());
+  EXPECT_EQ(2u, queue.consume([](int) {}));
+  EXPECT_EQ(0u, queue.consume([](int) {}));
+}
+
+TEST(mpsc_queue_test, destroys_remaining_items) {
+  auto item = std::make_shared<int>(1);
+  {
+    MpscQueue<std::shared_ptr<int>> queue;
+    queue.push(item);
+    queue.push(item);
+    EXPECT_EQ(3, item.use_count());
+  }
+  EXPECT_EQ(1, item.use_count());
+}
+
+TEST(mpsc_queue_test, multi_producer_order) {
+  const int kProducers = 4;
+  const int kItems = 100000;
+  MpscQueue<std::pair<int, int>> queue;
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&queue, p]() {
+      for (int i = 0; i < kItems; ++i) {
+        queue.push(std::make_pair(p, i));
+      }
+    });
+  }
+
+  std::vector<int> next(kProducers, 0);
+  int received = 0;
+  while (received < kProducers * kItems) {
+    queue.consume([&next, &received](const std::pair<int, int> &item) {
+      // every producer's items arrive in order
+      ASSERT_EQ(next[item.first], item.second);
+      ++next[item.first];
+      ++received;
+    });
+  }
+  for (auto &producer : producers) {
+    producer.join();
+  }
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(mpsc_queue_test, steady_state_does_not_allocate) {
+  MpscQueue<Task<void()>> queue;
+  int calls = 0;
+  auto post = [&queue, &calls](int batch) {
+    for (int i = 0; i < batch; ++i) {
+      queue.push([&calls]() { ++calls; });
+    }
+    queue.consume([](const Task<void()> &task) { task(); });
+  };
+  // the first round allocates the nodes of the working depth
+  post(64);
+  EXPECT_GE(queue.freeNodes(), 63u);
+
+  size_t allocations = g_allocations.load();
+  for (int round = 0; round < 1000; ++round) {
+    post(1 + round % 64);
+  }
+  EXPECT_EQ(allocations, g_allocations.load());
+  EXPECT_EQ(64 + 1000 / 64 * (64 * 65 / 2) + 40 * 41 / 2, calls);
+}
+
+TEST(mpsc_queue_test, free_list_is_bounded) {
+  MpscQueue<int> queue;
+  const size_t n = MpscQueue<int>::kMaxFreeNodes + 100;
+  for (size_t i = 0; i < n; ++i) {
+    queue.push(static_cast<int>(i));
+  }
+  EXPECT_EQ(n, queue.consume([](int) {}));
+  EXPECT_EQ(MpscQueue<int>::kMaxFreeNodes, queue.freeNodes());
+}
+
+int main() {
+  testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,80 @@
+#include "base/Task.h"
+
+#include "gtest/gtest.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+
+using namespace bamboo;
+
+namespace {
+
+struct Counter {
+  void add(const std::string &s) { total += s.size(); }
+  size_t total{0};
+};
+
+} // namespace
+
+TEST(task_test, empty) {
+  Task<void()> task;
+  EXPECT_FALSE(task);
+  task = [] {};
+  EXPECT_TRUE(task);
+  task = nullptr;
+  EXPECT_FALSE(task);
+}
+
+TEST(task_test, bind_is_inline) {
+  Counter counter;
+  auto conn = std::make_shared<int>(0);
+  auto bound = std::bind(&Counter::add, &counter, std::string(100, 'x'));
+  using Bound = decltype(bound);
+  EXPECT_TRUE(Task<void()>::storedInline<Bound>());
+  // what a cross thread send queues
+  std::string message;
+  auto send = [conn, message]() {};
+  EXPECT_TRUE(Task<void()>::storedInline<decltype(send)>());
+
+  Task<void()> task(std::move(bound));
+  task();
+  Task<void()> moved(std::move(task));
+  EXPECT_FALSE(task);
+  moved();
+  EXPECT_EQ(200u, counter.total);
+}
+
+TEST(task_test, large_callable_on_heap) {
+  struct Big {
+    char data[200];
+  };
+  Big big;
+  big.data[199] = 7;
+  int result = 0;
+  auto f = [big, &result](int x) { result = big.data[199] + x; };
+  EXPECT_FALSE(Task<void(int)>::storedInline<decltype(f)>());
+
+  Task<void(int)> task(f);
+  Task<void(int)> other;
+  other = std::move(task);
+  other(1);
+  EXPECT_EQ(8, result);
+}
+
+TEST(task_test, destroys_callable) {
+  auto owned = std::make_shared<int>(1);
+  {
+    Task<int()> task([owned]() { return *owned; });
+    EXPECT_EQ(2, owned.use_count());
+    EXPECT_EQ(1, task());
+    Task<int()> moved(std::move(task));
+    EXPECT_EQ(2, owned.use_count());
+  }
+  EXPECT_EQ(1, owned.use_count());
+}
+
+int main() {
+  testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
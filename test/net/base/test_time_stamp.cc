@@ -8,6 +8,16 @@ TEST(test_ts, toString) {
   EXPECT_STREQ("1970-01-01 03:25:36.789", ts.toString().c_str());
 }
 
+TEST(test_ts, coarseNow) {
+  TimeStamp coarse = TimeStamp::coarseNow();
+  TimeStamp precise = TimeStamp::now();
+  // behind by at most a few ticks of the kernel clock
+  EXPECT_LE(coarse.microSecondsSinceEpoch(),
+            precise.microSecondsSinceEpoch() + 1000);
+  EXPECT_LT(precise.microSecondsSinceEpoch() - coarse.microSecondsSinceEpoch(),
+            100 * 1000);
+}
+
 int main() {
   testing::InitGoogleTest();
   return RUN_ALL_TESTS();
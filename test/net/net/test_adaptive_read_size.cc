@@ -0,0 +1,34 @@
+#include "net/AdaptiveReadSize.h"
+
+#include "gtest/gtest.h"
+
+using namespace bamboo;
+
+TEST(adaptive_read_size_test, grow_and_shrink) {
+    const size_t min_size = AdaptiveReadSize::kMinSize;
+    const size_t max_size = AdaptiveReadSize::kMaxSize;
+    AdaptiveReadSize size;
+    EXPECT_EQ(size.next(), min_size);
+
+    // full reads double the size up to the max
+    for (int i = 0; i < 20; ++i) {
+        size.record(size.next());
+    }
+    EXPECT_EQ(size.next(), max_size);
+
+    // one small read is not enough to shrink
+    size.record(10);
+    EXPECT_EQ(size.next(), max_size);
+    size.record(10);
+    EXPECT_EQ(size.next(), max_size / 2);
+
+    for (int i = 0; i < 40; ++i) {
+        size.record(10);
+    }
+    EXPECT_EQ(size.next(), min_size);
+}
+
+int main() {
+    testing::InitGoogleTest();
+    return RUN_ALL_TESTS();
+}
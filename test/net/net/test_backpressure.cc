@@ -0,0 +1,244 @@
+#include "net/EventLoop.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include "gtest/gtest.h"
+
+#include <set>
+#include <string>
+
+using namespace bamboo;
+
+// a client pipelines requests without reading the replies; the server
+// pauses reading it, stopRead() keeps it paused after the output drains
+// and every reply arrives once both sides read again
+TEST(backpressure_test, pipelined_client_that_does_not_read) {
+  const int kRequests = 4000;
+  const std::string reply = std::string(8192, 'r') + "\n";
+
+  EventLoop loop;
+  InetAddress addr(19331);
+  TcpServer server(&loop, addr, "BackpressureServer");
+  server.setBackpressure(64 * 1024, 16 * 1024);
+  TcpConnectionPtr server_conn;
+  int handled = 0;
+  server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+      server_conn = conn;
+    }
+  });
+  server.setMessageCallback(
+      [&](const TcpConnectionPtr &conn, Buffer *buf, TimeStamp) {
+        // like BambooServer, requests are left in the buffer while the
+        // connection is backpressured
+        const char *eol;
+        while (!conn->backpressured() && (eol = buf->findEOL()) != nullptr) {
+          buf->retrieveUntil(eol + 1);
+          conn->send(reply);
+          ++handled;
+        }
+      });
+  server.start();
+
+  size_t received = 0;
+  TcpClient client(&loop, addr, "BackpressureClient");
+  client.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+      conn->stopRead();
+      std::string requests;
+      for (int i = 0; i < kRequests; ++i) {
+        requests += "GET\n";
+      }
+      conn->send(requests);
+    }
+  });
+  client.setMessageCallback(
+      [&](const TcpConnectionPtr &, Buffer *buf, TimeStamp) {
+        received += buf->readableBytes();
+        buf->retrieveAll();
+        if (received == kRequests * reply.size()) {
+          loop.quit();
+        }
+      });
+  client.connect();
+
+  enum Phase { kFilling, kDraining, kStopped, kResumed };
+  Phase phase = kFilling;
+  int handled_when_stopped = 0;
+  TimeStamp stopped_at;
+  TimerId check = loop.runEvery(0.005, [&]() {
+    if (!server_conn) {
+      return;
+    }
+    switch (phase) {
+    case kFilling:
+      if (server_conn->backpressured()) {
+        // paused by backpressure, the read setting is untouched
+        EXPECT_TRUE(server_conn->isReading());
+        EXPECT_LT(handled, kRequests);
+        server_conn->stopRead();
+        client.connection()->startRead();
+        phase = kDraining;
+      }
+      break;
+    case kDraining:
+      if (!server_conn->backpressured()) {
+        EXPECT_FALSE(server_conn->isReading());
+        handled_when_stopped = handled;
+        stopped_at = TimeStamp::now();
+        phase = kStopped;
+      }
+      break;
+    case kStopped:
+      // the drained output does not resume a stopped connection
+      EXPECT_EQ(handled_when_stopped, handled);
+      if (TimeStamp::now().microSecondsSinceEpoch() -
+              stopped_at.microSecondsSinceEpoch() >
+          100 * 1000) {
+        server_conn->startRead();
+        phase = kResumed;
+      }
+      break;
+    case kResumed:
+      break;
+    }
+  });
+  TimerId timeout = loop.runAfter(20.0, [&loop]() { loop.quit(); });
+  loop.loop();
+  loop.cancel(check);
+  loop.cancel(timeout);
+
+  EXPECT_EQ(kResumed, phase);
+  EXPECT_EQ(kRequests, handled);
+  EXPECT_EQ(kRequests * reply.size(), received);
+  EXPECT_TRUE(server_conn->isReading());
+  EXPECT_FALSE(server_conn->backpressured());
+
+  // the server closes its side once the last reference is gone
+  server_conn.reset();
+  client.disconnect();
+  loop.runAfter(0.1, [&loop]() { loop.quit(); });
+  loop.loop();
+}
+
+// a client sends most of the shared input budget as a line that never ends,
+// then a pipelined client reads its requests and is paused by backpressure
+// while the budget is exceeded; only the client holding more than its
+// share is dropped, once it floods again
+TEST(backpressure_test, flooding_client_and_paused_client_share_a_budget) {
+  const int kRequests = 4000;
+  const std::string reply = std::string(8192, 'r') + "\n";
+  const std::string flood(128 * 1024, 'x');
+  const size_t kBudget = 170 * 1024;
+
+  EventLoop loop;
+  InetAddress addr(19332);
+  TcpServer server(&loop, addr, "BudgetServer");
+  server.setBackpressure(64 * 1024, 16 * 1024);
+  server.setInputLimits(0, kBudget);
+  std::set<TcpConnectionPtr> dropped;
+  server.setInputLimitCallback(
+      [&](const TcpConnectionPtr &conn, size_t) { dropped.insert(conn); });
+  TcpConnectionPtr flooding_conn;
+  TcpConnectionPtr paused_conn;
+  int handled = 0;
+  server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+      (flooding_conn ? paused_conn : flooding_conn) = conn;
+    }
+  });
+  server.setMessageCallback(
+      [&](const TcpConnectionPtr &conn, Buffer *buf, TimeStamp) {
+        const char *eol;
+        while (!conn->backpressured() && (eol = buf->findEOL()) != nullptr) {
+          buf->retrieveUntil(eol + 1);
+          conn->send(reply);
+          ++handled;
+        }
+      });
+  server.start();
+
+  TcpClient flooding(&loop, addr, "FloodingClient");
+  flooding.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+      conn->send(flood);
+    }
+  });
+  flooding.connect();
+
+  size_t received = 0;
+  TcpClient paused(&loop, addr, "PausedClient");
+  paused.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+      conn->stopRead();
+      std::string requests;
+      for (int i = 0; i < kRequests; ++i) {
+        requests += "GET\n";
+      }
+      conn->send(requests);
+    }
+  });
+  paused.setMessageCallback(
+      [&](const TcpConnectionPtr &, Buffer *buf, TimeStamp) {
+        received += buf->readableBytes();
+        buf->retrieveAll();
+      });
+
+  enum Phase { kFlooding, kPipelining, kPaused, kDone };
+  Phase phase = kFlooding;
+  bool exceeded = false;
+  TimerId check = loop.runEvery(0.005, [&]() {
+    switch (phase) {
+    case kFlooding:
+      // the first chunk of the pipelined input goes over the budget
+      if (server.inputBytes() > kBudget - BufferChunk::kSize) {
+        EXPECT_LE(server.inputBytes(), kBudget);
+        paused.connect();
+        phase = kPipelining;
+      }
+      break;
+    case kPipelining:
+      if (paused_conn && paused_conn->backpressured()) {
+        exceeded = server.inputBytes() > kBudget;
+        paused.connection()->startRead();
+        phase = kPaused;
+      }
+      break;
+    case kPaused:
+      if (received == kRequests * reply.size()) {
+        flooding.connection()->send(flood);
+        phase = kDone;
+      }
+      break;
+    case kDone:
+      if (!dropped.empty()) {
+        loop.quit();
+      }
+      break;
+    }
+  });
+  TimerId timeout = loop.runAfter(10.0, [&loop]() { loop.quit(); });
+  loop.loop();
+  loop.cancel(check);
+  loop.cancel(timeout);
+
+  EXPECT_TRUE(exceeded);
+  EXPECT_EQ(kDone, phase);
+  EXPECT_EQ(std::set<TcpConnectionPtr>{flooding_conn}, dropped);
+  EXPECT_EQ(kRequests, handled);
+  EXPECT_EQ(kRequests * reply.size(), received);
+
+  dropped.clear();
+  flooding_conn.reset();
+  paused_conn.reset();
+  flooding.disconnect();
+  paused.disconnect();
+  loop.runAfter(0.1, [&loop]() { loop.quit(); });
+  loop.loop();
+}
+
+int main() {
+  testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,214 @@
+#include "net/BambooProxy.h"
+
+#include "net/BambooServer.h"
+#include "net/ConsistentHash.h"
+#include "net/EventLoop.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+
+#include "gtest/gtest.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace bamboo;
+
+namespace {
+
+std::string tempDir() {
+  char dir[] = "/tmp/test_bamboo_proxy.XXXXXX";
+  return ::mkdtemp(dir);
+}
+
+// lines of a LIST reply without the blank line at the end, sorted
+std::vector<std::string> listEntries(const std::string &reply) {
+  std::vector<std::string> entries;
+  size_t start = 0;
+  size_t eol;
+  while ((eol = reply.find("\r\n", start)) != std::string::npos &&
+         eol > start) {
+    entries.emplace_back(reply, start, eol - start);
+    start = eol + 2;
+  }
+  std::sort(entries.begin(), entries.end());
+  return entries;
+}
+
+// send commands through the proxy, return once size bytes of replies are in
+std::string roundTrip(EventLoop *loop, const InetAddress &proxyAddr,
+                      const std::string &commands, size_t size) {
+  std::string replies;
+  TcpClient client(loop, proxyAddr, "ProxyTestClient");
+  client.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+      conn->send(commands);
+    }
+  });
+  client.setMessageCallback(
+      [&](const TcpConnectionPtr &, Buffer *buf, TimeStamp) {
+        replies += buf->retrieveAllString();
+        if (replies.size() >= size) {
+          loop->quit();
+        }
+      });
+  // let the proxy connect to its backends first
+  loop->runAfter(0.1, [&client]() { client.connect(); });
+  TimerId timeout = loop->runAfter(10.0, [loop]() { loop->quit(); });
+  loop->loop();
+  loop->cancel(timeout);
+
+  client.disconnect();
+  loop->runAfter(0.1, [loop]() { loop->quit(); });
+  loop->loop();
+  return replies;
+}
+
+} // namespace
+
+TEST(bamboo_proxy_test, commands_over_two_backends) {
+  EventLoop loop;
+  InetAddress backend_addr1(19311);
+  InetAddress backend_addr2(19312);
+  InetAddress proxy_addr(19313);
+  std::unique_ptr<BambooServer> backend1(
+      new BambooServer(&loop, backend_addr1, tempDir()));
+  std::unique_ptr<BambooServer> backend2(
+      new BambooServer(&loop, backend_addr2, tempDir()));
+  backend1->start();
+  backend2->start();
+  BambooProxy proxy(&loop, proxy_addr, {backend_addr1, backend_addr2});
+  proxy.start();
+
+  // spread over both backends by the ring
+  std::string mset = "MSET";
+  std::string mget = "MGET";
+  std::vector<std::string> entries;
+  for (int i = 0; i < 20; ++i) {
+    auto key = "key" + std::to_string(i);
+    mset += " " + key + " " + std::to_string(i);
+    mget += " " + key;
+    entries.push_back(key + ": " + std::to_string(i));
+  }
+  mget += " missing";
+  entries.push_back("a: 1");
+  std::sort(entries.begin(), entries.end());
+
+  std::string replies;
+  TcpClient client(&loop, proxy_addr, "ProxyTestClient");
+  client.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+      conn->send("SET a 1\r\nGET a\r\nGET missing\r\n" + mset + "\r\n" +
+                 mget + "\r\nLIST\r\n");
+    }
+  });
+  client.setMessageCallback(
+      [&](const TcpConnectionPtr &conn, Buffer *buf, TimeStamp) {
+        replies += buf->retrieveAllString();
+        // LIST is the last reply and the only one with a blank line
+        if (replies.find("\r\n\r\n") != std::string::npos) {
+          loop.quit();
+        }
+      });
+  // let the proxy connect to its backends first
+  loop.runAfter(0.1, [&client]() { client.connect(); });
+  TimerId timeout = loop.runAfter(10.0, [&loop]() { loop.quit(); });
+  loop.loop();
+  loop.cancel(timeout);
+
+  std::string expected = "OK\r\n1\r\nNOT FOUND\r\nOK\r\n";
+  for (int i = 0; i < 20; ++i) {
+    expected += std::to_string(i) + "\r\n";
+  }
+  expected += "NOT FOUND\r\n";
+  ASSERT_GE(replies.size(), expected.size());
+  EXPECT_EQ(expected, replies.substr(0, expected.size()));
+  EXPECT_EQ(entries, listEntries(replies.substr(expected.size())));
+
+  // close every connection in the loop before the objects go away
+  client.disconnect();
+  backend1.reset();
+  backend2.reset();
+  loop.runAfter(0.2, [&loop]() { loop.quit(); });
+  loop.loop();
+}
+
+// replies are framed by their shape, not by what the keys look like
+TEST(bamboo_proxy_test, list_entries_like_single_line_replies) {
+  EventLoop loop;
+  InetAddress backend_addr(19314);
+  InetAddress proxy_addr(19315);
+  std::unique_ptr<BambooServer> backend(
+      new BambooServer(&loop, backend_addr, tempDir()));
+  backend->start();
+  BambooProxy proxy(&loop, proxy_addr, {backend_addr});
+  proxy.start();
+
+  // an entry line starting with ERROR, then a reply after the list
+  const std::string expected = "OK\r\nERROR: x\r\n\r\nx\r\n";
+  auto replies = roundTrip(&loop, proxy_addr,
+                           "SET ERROR x\r\nLIST\r\nGET ERROR\r\n",
+                           expected.size());
+  EXPECT_EQ(expected, replies);
+
+  // only commands the proxy serves are listed
+  auto help = roundTrip(&loop, proxy_addr, "HELP\r\n", 1);
+  EXPECT_NE(std::string::npos, help.find("MGET"));
+  EXPECT_EQ(std::string::npos, help.find("INFO"));
+  EXPECT_EQ(std::string::npos, help.find("SLOWLOG"));
+  EXPECT_EQ(std::string::npos, help.find("HOTKEYS"));
+
+  backend.reset();
+  loop.runAfter(0.1, [&loop]() { loop.quit(); });
+  loop.loop();
+}
+
+// keys of a backend that is down get its error, the others their values
+TEST(bamboo_proxy_test, mget_with_a_backend_down) {
+  EventLoop loop;
+  InetAddress backend_addr(19316);
+  // nothing listens here
+  InetAddress down_addr(19317);
+  InetAddress proxy_addr(19318);
+  std::unique_ptr<BambooServer> backend(
+      new BambooServer(&loop, backend_addr, tempDir()));
+  backend->start();
+  BambooProxy proxy(&loop, proxy_addr, {backend_addr, down_addr});
+  proxy.start();
+
+  // the same ring as the proxy's
+  ConsistentHash ring;
+  ring.addNode(backend_addr.toIpPort());
+  ring.addNode(down_addr.toIpPort());
+  std::string mset = "MSET";
+  std::string mget = "MGET";
+  std::string expected;
+  std::string expected_mget;
+  for (int i = 0; i < 10; ++i) {
+    auto key = "key" + std::to_string(i);
+    mget += " " + key;
+    if (ring.nodeOf(key) == 0) {
+      mset += " " + key + " " + std::to_string(i);
+      expected_mget += std::to_string(i) + "\r\n";
+    } else {
+      expected_mget += "ERROR: backend unavailable\r\n";
+    }
+  }
+  ASSERT_NE("MSET", mset);
+  expected = "OK\r\n" + expected_mget;
+  auto replies = roundTrip(&loop, proxy_addr, mset + "\r\n" + mget + "\r\n",
+                           expected.size());
+  EXPECT_EQ(expected, replies);
+
+  backend.reset();
+  loop.runAfter(0.1, [&loop]() { loop.quit(); });
+  loop.loop();
+}
+
+int main() {
+  testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,124 @@
+#include "net/BambooServer.h"
+
+#include "base/Histogram.h"
+#include "net/EventLoop.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+
+#include "gtest/gtest.h"
+
+#include <stdlib.h>
+
+#include <memory>
+#include <string>
+
+using namespace bamboo;
+
+namespace {
+
+std::string tempDir() {
+  char dir[] = "/tmp/test_bamboo_server.XXXXXX";
+  return ::mkdtemp(dir);
+}
+
+} // namespace
+
+// a line split across reads is counted once, when it is consumed
+TEST(bamboo_server_test, bytes_in_of_partial_lines) {
+  EventLoop loop;
+  InetAddress addr(19321);
+  std::unique_ptr<BambooServer> server(
+      new BambooServer(&loop, addr, tempDir()));
+  server->start();
+
+  const std::string first = "SET a 1\r\nGE";
+  const std::string second = "T a\r\n";
+  std::string replies;
+  TcpClient client(&loop, addr, "BytesInClient");
+  client.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+      conn->send(first);
+      // the rest arrives in a later read
+      loop.runAfter(0.05, [conn, &second]() { conn->send(second); });
+    }
+  });
+  client.setMessageCallback(
+      [&](const TcpConnectionPtr &conn, Buffer *buf, TimeStamp) {
+        replies += buf->retrieveAllString();
+        if (replies == "OK\r\n1\r\n") {
+          loop.quit();
+        }
+      });
+  client.connect();
+  TimerId timeout = loop.runAfter(10.0, [&loop]() { loop.quit(); });
+  loop.loop();
+  loop.cancel(timeout);
+
+  EXPECT_EQ("OK\r\n1\r\n", replies);
+  EXPECT_EQ(first.size() + second.size(), server->stats().bytesIn());
+  EXPECT_EQ(replies.size(), server->stats().bytesOut());
+
+  client.disconnect();
+  server.reset();
+  loop.runAfter(0.1, [&loop]() { loop.quit(); });
+  loop.loop();
+}
+
+// every le of the latency histogram is the upper edge of one of its
+// buckets, so the cumulative counts are exact
+TEST(bamboo_server_test, latency_buckets_at_histogram_edges) {
+  EventLoop loop;
+  InetAddress addr(19322);
+  std::unique_ptr<BambooServer> server(
+      new BambooServer(&loop, addr, tempDir()));
+  server->start();
+
+  std::string replies;
+  TcpClient client(&loop, addr, "MetricsClient");
+  client.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+      conn->send("SET a 1\r\n");
+    }
+  });
+  client.setMessageCallback(
+      [&](const TcpConnectionPtr &, Buffer *buf, TimeStamp) {
+        replies += buf->retrieveAllString();
+        loop.quit();
+      });
+  client.connect();
+  TimerId timeout = loop.runAfter(10.0, [&loop]() { loop.quit(); });
+  loop.loop();
+  loop.cancel(timeout);
+  ASSERT_EQ("OK\r\n", replies);
+
+  auto metrics = server->metrics();
+  const std::string prefix =
+      "bamboo_command_latency_seconds_bucket{command=\"set\",le=\"";
+  int buckets = 0;
+  size_t pos = 0;
+  while ((pos = metrics.find(prefix, pos)) != std::string::npos) {
+    pos += prefix.size();
+    auto le = metrics.substr(pos, metrics.find('"', pos) - pos);
+    if (le == "+Inf") {
+      continue;
+    }
+    auto micros = static_cast<uint64_t>(::atof(le.c_str()) * 1e6 + 0.5);
+    EXPECT_EQ(micros, Histogram::upperBound(Histogram::bucketOf(micros)))
+        << le;
+    ++buckets;
+  }
+  EXPECT_GT(buckets, 0);
+  // 1ms falls inside a bucket, its edge is listed instead
+  EXPECT_EQ(std::string::npos, metrics.find(prefix + "0.001\""));
+  EXPECT_NE(std::string::npos, metrics.find(prefix + "0.001007\""));
+
+  client.disconnect();
+  server.reset();
+  loop.runAfter(0.1, [&loop]() { loop.quit(); });
+  loop.loop();
+}
+
+int main() {
+  testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
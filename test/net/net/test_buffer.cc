@@ -14,6 +14,81 @@ TEST(buffer_test, basic_test) {
     
 }
 
+TEST(buffer_test, reuse_and_shrink) {
+    Buffer buf;
+    std::string data(800, 'a');
+    buf.append(data);
+    buf.retrieve(700);
+    // retrieved bytes are reused before the buffer grows
+    buf.append(data);
+    EXPECT_EQ(buf.readableBytes(), 900);
+    EXPECT_EQ(buf.internalCapacity(), Buffer::kCheapPrepend +
+                                          Buffer::kInitialSize);
+
+    buf.append(std::string(10000, 'b'));
+    buf.retrieve(10800);
+    buf.shrink(0);
+    EXPECT_EQ(buf.internalCapacity(), Buffer::kCheapPrepend + 100);
+    EXPECT_EQ(std::string(buf.peek(), buf.readableBytes()),
+              std::string(100, 'b'));
+}
+
+TEST(buffer_test, lazy_and_reclaim) {
+    Buffer buf(0);
+    EXPECT_EQ(buf.internalCapacity(), 0);
+    EXPECT_EQ(buf.writeableBytes(), 0);
+
+    // storage fitting a chunk comes from the pool
+    ChunkPool::put(ChunkPool::get());
+    size_t free_chunks = ChunkPool::freeChunks();
+    buf.append("hello");
+    EXPECT_EQ(buf.internalCapacity(), BufferChunk::kSize);
+    EXPECT_EQ(ChunkPool::freeChunks(), free_chunks - 1);
+    buf.retrieveAll();
+    buf.reclaim();
+    EXPECT_EQ(buf.internalCapacity(), 0);
+    EXPECT_EQ(ChunkPool::freeChunks(), free_chunks);
+
+    // a burst grows the buffer, little of it left in use shrinks it back
+    buf.append(std::string(100000, 'a'));
+    buf.retrieve(99990);
+    buf.reclaim();
+    EXPECT_EQ(buf.internalCapacity(), BufferChunk::kSize);
+    EXPECT_EQ(buf.retrieveAllString(), std::string(10, 'a'));
+
+    // a buffer in use keeps its storage
+    buf.append("world");
+    buf.reclaim();
+    EXPECT_EQ(buf.internalCapacity(), BufferChunk::kSize);
+}
+
+TEST(buffer_test, resumed_scan) {
+    Buffer buf;
+    buf.append("SET k ");
+    EXPECT_EQ(buf.findEOL(), nullptr);
+    EXPECT_EQ(buf.findCRLF(), nullptr);
+    buf.append("v\r");
+    EXPECT_EQ(buf.findCRLF(), nullptr);
+    buf.append("\nGET k\nGET j\r\n");
+    // the scan resumes before a '\r' left at the end
+    EXPECT_EQ(buf.findCRLF(), buf.peek() + 7);
+    buf.retrieveUntil(buf.findEOL() + 1);
+    EXPECT_EQ(buf.findEOL(), buf.peek() + 5);
+    // a lone '\n' does not end a CRLF line, but still ends an EOL one
+    EXPECT_EQ(buf.findCRLF(), buf.peek() + 11);
+    EXPECT_EQ(buf.findEOL(), buf.peek() + 5);
+
+    // retrieving past the scanned bytes starts the next scan at peek()
+    buf.retrieve(8);
+    EXPECT_EQ(buf.findEOL(), buf.peek() + 4);
+
+    // a scan stays valid when the buffer grows and moves its bytes
+    buf.retrieveAll();
+    buf.append(std::string(100, 'x'));
+    EXPECT_EQ(buf.findEOL(), nullptr);
+    buf.append(std::string(100000, 'y') + "\n");
+    EXPECT_EQ(buf.findEOL(), buf.peek() + 100100);
+}
 
 int main() {
     testing::InitGoogleTest();
@@ -0,0 +1,59 @@
+#include "net/ChainBuffer.h"
+
+#include "gtest/gtest.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace bamboo;
+
+TEST(chain_buffer_test, append_and_retrieve) {
+    ChainBuffer buf;
+    EXPECT_EQ(buf.readableBytes(), 0);
+    EXPECT_EQ(buf.chunks(), 0);
+
+    std::string data(BufferChunk::kSize + 100, 'a');
+    buf.append(data);
+    EXPECT_EQ(buf.readableBytes(), data.size());
+    EXPECT_EQ(buf.chunks(), 2);
+
+    // the last chunk is filled before a new one is linked
+    buf.append(std::string(100, 'b'));
+    EXPECT_EQ(buf.chunks(), 2);
+
+    buf.retrieve(BufferChunk::kSize);
+    EXPECT_EQ(buf.chunks(), 1);
+    EXPECT_EQ(buf.retrieveAllString(),
+              std::string(100, 'a') + std::string(100, 'b'));
+    EXPECT_EQ(buf.chunks(), 0);
+    EXPECT_GE(ChunkPool::freeChunks(), 2);
+}
+
+TEST(chain_buffer_test, write_fd) {
+    int fds[2];
+    ASSERT_EQ(::pipe2(fds, O_NONBLOCK), 0);
+    std::string data;
+    for (int i = 0; i < 3 * BufferChunk::kSize; ++i) {
+        data.push_back(static_cast<char>('a' + i % 26));
+    }
+    ChainBuffer buf;
+    buf.append(data.data(), 10);
+    buf.append(data.data() + 10, data.size() - 10);
+
+    int saved_err = 0;
+    auto n = buf.writeFd(fds[1], &saved_err);
+    EXPECT_EQ(n, static_cast<ssize_t>(data.size()));
+    EXPECT_EQ(buf.readableBytes(), 0);
+
+    std::string out(data.size(), '\0');
+    EXPECT_EQ(::read(fds[0], &out[0], out.size()),
+              static_cast<ssize_t>(out.size()));
+    EXPECT_EQ(out, data);
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+int main() {
+    testing::InitGoogleTest();
+    return RUN_ALL_TESTS();
+}
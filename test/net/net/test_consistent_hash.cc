@@ -0,0 +1,61 @@
+#include "net/ConsistentHash.h"
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+using namespace bamboo;
+
+TEST(consistent_hash_test, empty_ring) {
+  ConsistentHash ring;
+  EXPECT_EQ(-1, ring.nodeOf("key"));
+}
+
+TEST(consistent_hash_test, balance) {
+  ConsistentHash ring;
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(i, ring.addNode("127.0.0.1:" + std::to_string(9981 + i)));
+  }
+
+  const int kKeys = 100000;
+  std::vector<int> counts(4);
+  for (int i = 0; i < kKeys; ++i) {
+    int node = ring.nodeOf("key" + std::to_string(i));
+    ASSERT_GE(node, 0);
+    ASSERT_LT(node, 4);
+    ++counts[node];
+  }
+  for (int count : counts) {
+    EXPECT_GT(count, kKeys / 4 * 7 / 10);
+    EXPECT_LT(count, kKeys / 4 * 13 / 10);
+  }
+}
+
+TEST(consistent_hash_test, add_node_moves_few_keys) {
+  ConsistentHash before;
+  ConsistentHash after;
+  for (int i = 0; i < 4; ++i) {
+    before.addNode("node" + std::to_string(i));
+    after.addNode("node" + std::to_string(i));
+  }
+  int added = after.addNode("node4");
+
+  const int kKeys = 100000;
+  int moved = 0;
+  for (int i = 0; i < kKeys; ++i) {
+    auto key = "key" + std::to_string(i);
+    int old_node = before.nodeOf(key);
+    int new_node = after.nodeOf(key);
+    if (old_node != new_node) {
+      // keys only move to the new node
+      EXPECT_EQ(added, new_node);
+      ++moved;
+    }
+  }
+  EXPECT_LT(moved, kKeys * 3 / 10);
+}
+
+int main() {
+  testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
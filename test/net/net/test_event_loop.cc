@@ -0,0 +1,143 @@
+#include "net/EventLoop.h"
+
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+#include <thread>
+#include <vector>
+
+using namespace bamboo;
+
+TEST(event_loop_test, priorities) {
+  EventLoop loop;
+  std::vector<int> order;
+  loop.queueInLoop([&order]() { order.push_back(2); },
+                   EventLoop::kBackground);
+  loop.queueInLoop([&order]() { order.push_back(1); });
+  loop.queueInLoop([&order]() { order.push_back(0); }, EventLoop::kUrgent);
+  loop.queueInLoop([&loop]() { loop.quit(); }, EventLoop::kBackground);
+  loop.loop();
+  EXPECT_EQ((std::vector<int>{0, 1, 2}), order);
+}
+
+TEST(event_loop_test, functor_budget) {
+  EventLoop loop;
+  loop.setFunctorBudget(10, 0);
+  std::vector<int64_t> iterations;
+  for (int i = 0; i < 35; ++i) {
+    loop.queueInLoop(
+        [&loop, &iterations]() { iterations.push_back(loop.iteration()); });
+  }
+  loop.queueInLoop([&loop]() { loop.quit(); });
+  // urgent functors are not limited
+  int urgent = 0;
+  for (int i = 0; i < 20; ++i) {
+    loop.queueInLoop([&urgent]() { ++urgent; }, EventLoop::kUrgent);
+  }
+  loop.runAfter(5.0, [&loop]() { loop.quit(); });
+  loop.loop();
+
+  EXPECT_EQ(20, urgent);
+  ASSERT_EQ(35u, iterations.size());
+  // 10 per iteration, the leftover does not wait for events
+  EXPECT_EQ(iterations.front() + 3, iterations.back());
+  EXPECT_EQ(iterations[0], iterations[9]);
+  EXPECT_NE(iterations[9], iterations[10]);
+  EXPECT_GE(loop.stats().functorBudgetExhausted(), 3u);
+}
+
+TEST(event_loop_test, background_deferred_by_budget) {
+  EventLoop loop;
+  loop.setFunctorBudget(10, 0);
+  std::vector<int64_t> normal;
+  std::vector<int64_t> background;
+  // queued first, still waits for the normal functors
+  for (int i = 0; i < 5; ++i) {
+    loop.queueInLoop(
+        [&loop, &background]() { background.push_back(loop.iteration()); },
+        EventLoop::kBackground);
+  }
+  for (int i = 0; i < 25; ++i) {
+    loop.queueInLoop(
+        [&loop, &normal]() { normal.push_back(loop.iteration()); });
+  }
+  loop.queueInLoop([&loop]() { loop.quit(); }, EventLoop::kBackground);
+  loop.runAfter(5.0, [&loop]() { loop.quit(); });
+  loop.loop();
+
+  ASSERT_EQ(25u, normal.size());
+  ASSERT_EQ(5u, background.size());
+  // two full iterations of normal work, background gets what is left of
+  // the third
+  EXPECT_EQ(normal.front() + 2, normal.back());
+  EXPECT_EQ(normal.back(), background.front());
+  EXPECT_EQ(background.front(), background.back());
+}
+
+// functor time is only measured once timing is on
+TEST(event_loop_test, iteration_timing) {
+  EventLoop loop;
+  auto slowFunctor = [&loop]() {
+    loop.queueInLoop([]() { ::usleep(20 * 1000); });
+    loop.queueInLoop([&loop]() { loop.quit(); });
+    loop.loop();
+  };
+  slowFunctor();
+  EXPECT_EQ(0u, loop.stats().pendingFunctorsTime());
+
+  loop.setIterationTiming(true);
+  slowFunctor();
+  EXPECT_GE(loop.stats().pendingFunctorsTime(), 20 * 1000u);
+}
+
+TEST(event_loop_test, cross_thread) {
+  EventLoop loop;
+  loop.setFunctorBudget(0, 100);
+  int count = 0;
+  std::thread producer([&]() {
+    for (int i = 0; i < 10000; ++i) {
+      loop.runInLoop([&count]() { ++count; });
+    }
+    loop.runInLoop([&loop]() { loop.quit(); }, EventLoop::kBackground);
+  });
+  loop.loop();
+  producer.join();
+  EXPECT_EQ(10000, count);
+}
+
+TEST(event_loop_test, timers) {
+  EventLoop loop;
+  std::vector<int> order;
+  loop.runAfter(0.02, [&order]() { order.push_back(2); });
+  loop.runAfter(0.01, [&order]() { order.push_back(1); });
+  auto canceled = loop.runAfter(0.005, [&order]() { order.push_back(-1); });
+  loop.cancel(canceled);
+
+  // a repeating timer cancels itself, a stale id is ignored
+  int ticks = 0;
+  TimerId every;
+  every = loop.runEvery(0.002, [&]() {
+    if (++ticks == 3) {
+      loop.cancel(every);
+      loop.cancel(canceled);
+    }
+  });
+  std::thread other([&loop, &order]() {
+    loop.runAfter(0.03, [&loop, &order]() {
+      order.push_back(3);
+      loop.quit();
+    });
+  });
+  other.join();
+  loop.runAfter(5.0, [&loop]() { loop.quit(); });
+  loop.loop();
+
+  EXPECT_EQ((std::vector<int>{1, 2, 3}), order);
+  EXPECT_EQ(3, ticks);
+}
+
+int main() {
+  testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
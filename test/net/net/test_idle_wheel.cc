@@ -0,0 +1,99 @@
+#include "net/IdleWheel.h"
+
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/TcpConnection.h"
+
+#include "gtest/gtest.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+
+using namespace bamboo;
+
+namespace {
+
+// a connection of the loop over one end of a socket pair, the other end is
+// left to the test
+struct Peer {
+  TcpConnectionPtr conn;
+  int fd{-1};
+  // time the connection went down
+  TimeStamp closed_at;
+};
+
+void connect(EventLoop *loop, const std::shared_ptr<IdleWheel> &wheel,
+             const std::string &name, Peer *peer) {
+  int fds[2];
+  ASSERT_EQ(0, ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds));
+  peer->fd = fds[1];
+  peer->conn = std::make_shared<TcpConnection>(loop, name, fds[0],
+                                               InetAddress(), InetAddress());
+  peer->conn->setIdleWheel(wheel);
+  peer->conn->setConnectionCallback([peer](const TcpConnectionPtr &conn) {
+    if (!conn->connected()) {
+      peer->closed_at = TimeStamp::now();
+    }
+  });
+  peer->conn->setMessageCallback(
+      [](const TcpConnectionPtr &, Buffer *buf, TimeStamp) {
+        buf->retrieveAll();
+      });
+  peer->conn->setCloseCallback([loop](const TcpConnectionPtr &conn) {
+    loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+  });
+  peer->conn->connectEstablished();
+}
+
+double secondsSince(TimeStamp start, TimeStamp end) {
+  return static_cast<double>(end.microSecondsSinceEpoch() -
+                             start.microSecondsSinceEpoch()) /
+         TimeStamp::kMicroSecondsPerSecond;
+}
+
+} // namespace
+
+TEST(idle_wheel_test, closes_idle_connections) {
+  EventLoop loop;
+  auto wheel = std::make_shared<IdleWheel>(&loop, 1);
+  wheel->start();
+  auto start = TimeStamp::now();
+
+  Peer idle;
+  Peer active;
+  connect(&loop, wheel, "idle", &idle);
+  connect(&loop, wheel, "active", &active);
+  // a read every 0.2s keeps the active connection in the newest bucket
+  TimerId reads = loop.runEvery(0.2, [&active]() {
+    ASSERT_EQ(1, ::write(active.fd, "x", 1));
+  });
+  loop.runAfter(2.5, [&loop]() { loop.quit(); });
+  loop.loop();
+
+  // the bucket holding the idle entry is dropped after 1 to 2 rotations
+  ASSERT_GT(idle.closed_at.microSecondsSinceEpoch(), 0);
+  EXPECT_GE(secondsSince(start, idle.closed_at), 1.0);
+  EXPECT_LE(secondsSince(start, idle.closed_at), 2.2);
+  EXPECT_FALSE(idle.conn->connected());
+  EXPECT_TRUE(active.conn->connected());
+  EXPECT_EQ(1u, wheel->closed());
+
+  // connections closed for other reasons are not counted
+  loop.cancel(reads);
+  active.conn->forceClose();
+  loop.runAfter(1.5, [&loop]() { loop.quit(); });
+  loop.loop();
+  EXPECT_FALSE(active.conn->connected());
+  EXPECT_EQ(1u, wheel->closed());
+
+  ::close(idle.fd);
+  ::close(active.fd);
+}
+
+int main() {
+  testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
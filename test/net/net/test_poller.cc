@@ -0,0 +1,128 @@
+#include "net/Channel.h"
+#include "net/EventLoop.h"
+#include "net/IoUringPoller.h"
+
+#include "gtest/gtest.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <thread>
+
+using namespace bamboo;
+
+namespace {
+
+// runs with epoll and with io_uring
+class PollerTest : public testing::TestWithParam<bool> {
+protected:
+  void SetUp() override {
+    if (GetParam()) {
+      ::setenv("BAMBOO_USE_IO_URING", "1", 1);
+    } else {
+      ::unsetenv("BAMBOO_USE_IO_URING");
+    }
+    ASSERT_EQ(0, ::pipe2(fds_, O_NONBLOCK | O_CLOEXEC));
+  }
+
+  void TearDown() override {
+    ::unsetenv("BAMBOO_USE_IO_URING");
+    ::close(fds_[0]);
+    ::close(fds_[1]);
+  }
+
+  int fds_[2];
+};
+
+bool ioUringAvailable() {
+  EventLoop *loop = nullptr;
+  IoUringPoller poller(loop);
+  return poller.valid();
+}
+
+} // namespace
+
+TEST_P(PollerTest, level_triggered) {
+  if (GetParam() && !ioUringAvailable()) {
+    GTEST_SKIP();
+  }
+  EventLoop loop;
+  Channel channel(&loop, fds_[0]);
+  int reads = 0;
+  // one byte per event, the rest must be reported again
+  channel.setReadCallback([&](TimeStamp) {
+    char c;
+    if (::read(fds_[0], &c, 1) == 1 && ++reads == 3) {
+      loop.quit();
+    }
+  });
+  channel.enableReading();
+  ASSERT_EQ(3, ::write(fds_[1], "abc", 3));
+  loop.runAfter(5.0, [&loop]() { loop.quit(); });
+  loop.loop();
+  EXPECT_EQ(3, reads);
+  channel.disableAll();
+  channel.remove();
+}
+
+TEST_P(PollerTest, edge_triggered) {
+  if (GetParam() && !ioUringAvailable()) {
+    GTEST_SKIP();
+  }
+  EventLoop loop;
+  Channel channel(&loop, fds_[0]);
+  int events = 0;
+  channel.setEdgeTriggered(true);
+  channel.setReadCallback([&](TimeStamp) {
+    char buf[16];
+    while (::read(fds_[0], buf, sizeof buf) > 0) {
+    }
+    if (++events == 2) {
+      loop.quit();
+    } else {
+      // new data after the drain is reported again
+      loop.queueInLoop([this]() { ::write(fds_[1], "b", 1); });
+    }
+  });
+  channel.enableReading();
+  ASSERT_EQ(1, ::write(fds_[1], "a", 1));
+  loop.runAfter(5.0, [&loop]() { loop.quit(); });
+  loop.loop();
+  EXPECT_EQ(2, events);
+  channel.disableAll();
+  channel.remove();
+}
+
+TEST_P(PollerTest, interest_change_and_wakeup) {
+  if (GetParam() && !ioUringAvailable()) {
+    GTEST_SKIP();
+  }
+  EventLoop loop;
+  Channel channel(&loop, fds_[1]);
+  int writable = 0;
+  channel.setWriteCallback([&]() {
+    ++writable;
+    channel.disableWriting();
+  });
+  channel.enableWriting();
+  int runs = 0;
+  std::thread other([&]() {
+    ::usleep(50 * 1000);
+    loop.runInLoop([&]() { ++runs; });
+    loop.runInLoop([&loop]() { loop.quit(); });
+  });
+  loop.loop();
+  other.join();
+  // disabled after the first event
+  EXPECT_EQ(1, writable);
+  EXPECT_EQ(1, runs);
+  channel.remove();
+}
+
+INSTANTIATE_TEST_SUITE_P(pollers, PollerTest, testing::Bool());
+
+int main() {
+  testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
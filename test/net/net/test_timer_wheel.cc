@@ -0,0 +1,100 @@
+#include "net/TimerWheel.h"
+#include "net/Timer.h"
+
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace bamboo;
+
+namespace {
+
+std::unique_ptr<Timer> timerAt(int64_t tick) {
+  return std::unique_ptr<Timer>(
+      new Timer(nullptr, TimerWheel::timeOf(tick), 0.0));
+}
+
+} // namespace
+
+TEST(timer_wheel_test, expire) {
+  const int64_t start = 1000000;
+  TimerWheel wheel(start);
+  std::mt19937_64 rng(42);
+  std::vector<std::unique_ptr<Timer>> timers;
+  for (int i = 0; i < 5000; ++i) {
+    // every level, a few past the wheel
+    int64_t delta = static_cast<int64_t>(rng() % (int64_t(1) << (i % 34)));
+    timers.push_back(timerAt(start + 1 + delta));
+    wheel.add(timers.back().get());
+  }
+  ASSERT_EQ(timers.size(), wheel.size());
+
+  size_t fired = 0;
+  std::vector<Timer *> expired;
+  while (!wheel.empty()) {
+    int64_t next = wheel.nextTick();
+    ASSERT_GT(next, wheel.currentTick());
+    int64_t target = next + static_cast<int64_t>(rng() % 3000);
+    expired.clear();
+    int64_t before = wheel.currentTick();
+    wheel.advance(target, &expired);
+    EXPECT_EQ(target, wheel.currentTick());
+    int64_t last = 0;
+    for (Timer *timer : expired) {
+      int64_t tick = TimerWheel::tickOf(timer->expiration());
+      EXPECT_GT(tick, before);
+      EXPECT_LE(tick, target);
+      EXPECT_GE(tick, last);
+      EXPECT_FALSE(timer->scheduled());
+      last = tick;
+    }
+    fired += expired.size();
+  }
+  EXPECT_EQ(timers.size(), fired);
+  EXPECT_EQ(TimerWheel::kNoTick, wheel.nextTick());
+}
+
+TEST(timer_wheel_test, remove) {
+  TimerWheel wheel(0);
+  std::vector<std::unique_ptr<Timer>> timers;
+  for (int64_t tick : {5, 5, 5, 300, 70000}) {
+    timers.push_back(timerAt(tick));
+    wheel.add(timers.back().get());
+  }
+  wheel.remove(timers[1].get());
+  wheel.remove(timers[3].get());
+  wheel.remove(timers[4].get());
+  EXPECT_EQ(2u, wheel.size());
+  EXPECT_EQ(5, wheel.nextTick());
+
+  std::vector<Timer *> expired;
+  wheel.advance(100000, &expired);
+  EXPECT_EQ((std::vector<Timer *>{timers[0].get(), timers[2].get()}),
+            expired);
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(timer_wheel_test, past_and_far) {
+  TimerWheel wheel(1000);
+  auto past = timerAt(10);
+  auto far = timerAt(1000 + (int64_t(1) << 40));
+  wheel.add(past.get());
+  wheel.add(far.get());
+  EXPECT_EQ(1001, wheel.nextTick());
+
+  std::vector<Timer *> expired;
+  wheel.advance(1001, &expired);
+  EXPECT_EQ(std::vector<Timer *>{past.get()}, expired);
+  expired.clear();
+  wheel.advance(1000 + (int64_t(1) << 40) - 1, &expired);
+  EXPECT_TRUE(expired.empty());
+  wheel.advance(1000 + (int64_t(1) << 40), &expired);
+  EXPECT_EQ(std::vector<Timer *>{far.get()}, expired);
+}
+
+int main() {
+  testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}